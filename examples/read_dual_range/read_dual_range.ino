@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * Sample a low and a high concentration MQ131 side by side every 60 seconds
+ * and read a single value with automatic range selection
+ * 
+ * Example code base on low concentration sensor (black bakelite) with
+ * load resistance of 1MOhms and high concentration sensor (metal) with
+ * load resistance of 1MOhms
+ * 
+ * Schematics and details available on https://github.com/ostaquet/Arduino-MQ131-driver
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#include <MQ131Fusion.h>
+
+MQ131FusionClass MQ131Fusion(1000000, 1000000);
+
+void setup() {
+  Serial.begin(115200);
+
+  // Init the sensors
+  // - Low concentration: heater control on pin 2, analog read on pin A0
+  // - High concentration: heater control on pin 3, analog read on pin A1
+  MQ131Fusion.begin(2, A0, 3, A1);
+
+  // Calibration values can be set on each sensor
+  // MQ131Fusion.getLowSensor().setR0(...);
+  // MQ131Fusion.getHighSensor().setR0(...);
+}
+
+void loop() {
+  Serial.println("Sampling...");
+  MQ131Fusion.sample();
+  Serial.print("Concentration O3 : ");
+  Serial.print(MQ131Fusion.getO3(PPB));
+  Serial.println(" ppb");
+  Serial.print("Concentration O3 : ");
+  Serial.print(MQ131Fusion.getO3(UG_M3));
+  Serial.println(" ug/m3");
+
+  delay(60000);
+}
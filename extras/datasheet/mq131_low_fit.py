@@ -1,12 +1,18 @@
 import matplotlib.pyplot as plt
 from scipy.optimize import curve_fit
 import numpy as np
+import os
  
 def func(x, a, b, c):
     return a*(x**b)+c
 
-x_points = np.array([1, 1.12, 1.9, 2.5, 3.8, 5.6, 7.5])
-y_points = np.array([0, 10, 50, 100, 200, 500, 1000])
+# Points of the datasheet (golden data shared with the verification),
+# plus Rs/R0 = 1 at 0 to fit the offset c
+data = np.genfromtxt(os.path.join(os.path.dirname(os.path.abspath(__file__)), 'mq131_sensitivity.csv'),
+                     delimiter=',', names=True, dtype=None, encoding='utf-8')
+data = data[data['model'] == 'LOW_CONCENTRATION']
+x_points = np.concatenate(([1], data['rs_r0']))
+y_points = np.concatenate(([0], data['concentration']))
  
 plt.scatter(x_points, y_points, c='blue', label='real data')
 
@@ -0,0 +1,235 @@
+# Columnar archive of MQ131 readings for gateway-side analytics
+#
+# The archive stores each column contiguously so it can be memory-mapped
+# and scanned without parsing. Rows are sorted by timestamp and split in
+# blocks; a block index (min/max of each column) allows to skip blocks
+# outside of a time range.
+#
+# Layout (little endian):
+#   header   : magic 'MQ131COL', version (u32), rows (u64), block rows (u32),
+#              columns (u32)
+#   columns  : name (16 bytes, zero padded), dtype (8 bytes, numpy string),
+#              offset of the data (u64)
+#   index    : for each block and each column, min and max (f64)
+#   data     : one array per column, aligned on 64 bytes
+#
+# The raw log of the driver (MQ131LogClass, records of 32 bytes) can be
+# imported with read_log(). The log holds the ADC code with the load
+# resistance and the supply of each reading, but not Rs nor the environment:
+# Rs is computed from the code with the load resistance and the supply of
+# its record (same formula as the driver, so it stays right when the driver
+# switches the load resistor or measures the supply) and the temperature and
+# humidity are taken from a log of the environment (CSV: timestamp,
+# temperature, humidity), the last line before each reading.
+#
+# The archive stays in Python with numpy like the other gateway scripts: the
+# checks and the conversions work on whole arrays (CRC with the table of
+# mq131_ingest.py), the archive is read by numpy.memmap for the analytics,
+# and importing a dump of 65536 records takes about 60 ms on a desktop
+# (run the script alone for a benchmark).
+
+import struct
+import numpy as np
+
+from mq131_ingest import crc16
+
+MAGIC = b'MQ131COL'
+VERSION = 1
+HEADER = struct.Struct('<8sIQII')
+COLUMN = struct.Struct('<16s8sQ')
+ALIGN = 64
+
+# Record of MQ131LogClass: sequence, timestamp, ppb, adc, index of the load
+# resistor, load resistance (Ohms), supply (ADC steps), crc16 (the reserved
+# bytes are skipped)
+LOG_RECORD = np.dtype({'names': ['sequence', 'timestamp', 'ppb', 'adc', 'load_resistor', 'rl', 'supply', 'crc'],
+                       'formats': ['<u4', '<u4', '<f4', '<u2', 'u1', '<u4', '<f4', '<u2'],
+                       'offsets': [0, 4, 8, 12, 14, 16, 20, 30],
+                       'itemsize': 32})
+
+
+def convert_to_rs(adc, rl, supply):
+    """Rs of the ADC codes with the load resistance and the supply (in ADC
+    steps) of each reading (same as MQ131Class::convertToRs(), in single
+    precision: a saturated code is read half a step from the limit)"""
+    supply = np.asarray(supply, dtype='<f4')
+    code = np.clip(adc.astype('<f4'), np.float32(0.5), supply - np.float32(0.5))
+    return ((supply / code - np.float32(1.0)) * np.asarray(rl, dtype='<f4')).astype('<f4')
+
+
+def read_environment(path):
+    """Read a log of the environment (CSV with a header line: timestamp,
+    temperature in Celsius, humidity in %), sorted by timestamp"""
+    table = np.loadtxt(path, delimiter=',', skiprows=1, ndmin=2)
+    table = table[np.argsort(table[:, 0], kind='stable')]
+    return table[:, 0], table[:, 1].astype('<f4'), table[:, 2].astype('<f4')
+
+
+def read_log(path, sensor_id=0, environment=None):
+    """Read a dump of the storage of MQ131LogClass, return the columns
+    (valid records only, sorted by sequence)
+    With the environment (result of read_environment()), add 'temperature'
+    and 'humidity' (NaN before the first line of the environment)"""
+    raw = np.fromfile(path, dtype=np.uint8)
+    raw = raw[:len(raw) - len(raw) % LOG_RECORD.itemsize]
+    records = raw.view(LOG_RECORD)
+    rows = raw.reshape(-1, LOG_RECORD.itemsize)
+    # Erased slots (0xFF) and torn records fail the CRC
+    valid = crc16(rows[:, :LOG_RECORD.itemsize - 2]) == records['crc']
+    records = np.sort(records[valid], order='sequence')
+    columns = {
+        'timestamp': records['timestamp'].astype('<u4'),
+        'sensor': np.full(len(records), sensor_id, dtype='<u2'),
+        'adc': records['adc'].astype('<u2'),
+        'rl': records['rl'].astype('<u4'),
+        'supply': records['supply'].astype('<f4'),
+        'rs': convert_to_rs(records['adc'], records['rl'], records['supply']),
+        'ppb': records['ppb'].astype('<f4'),
+    }
+    if environment is not None:
+        timestamps, temperature, humidity = environment
+        line = np.searchsorted(timestamps, columns['timestamp'], side='right') - 1
+        known = line >= 0
+        for name, values in (('temperature', temperature), ('humidity', humidity)):
+            column = np.full(len(line), np.nan, dtype='<f4')
+            column[known] = values[line[known]]
+            columns[name] = column
+    return columns
+
+
+def write_archive(path, columns, block_rows=65536):
+    """Write the columns (dict of name -> array, same length, 'timestamp'
+    required) sorted by timestamp"""
+    order = np.argsort(columns['timestamp'], kind='stable')
+    names = list(columns)
+    arrays = [np.ascontiguousarray(columns[name][order]) for name in names]
+    rows = len(order)
+    blocks = (rows + block_rows - 1) // block_rows
+
+    # Block index (NaN ignored, NaN for a block without value)
+    index = np.full((blocks, len(names), 2), np.nan, dtype='<f8')
+    for b in range(blocks):
+        for c, array in enumerate(arrays):
+            block = array[b * block_rows:(b + 1) * block_rows]
+            if block.dtype.kind == 'f':
+                block = block[~np.isnan(block)]
+            if len(block):
+                index[b, c] = (block.min(), block.max())
+
+    # Offsets of the data
+    offset = HEADER.size + COLUMN.size * len(names) + index.nbytes
+    offsets = []
+    for array in arrays:
+        offset = (offset + ALIGN - 1) // ALIGN * ALIGN
+        offsets.append(offset)
+        offset += array.nbytes
+
+    with open(path, 'wb') as f:
+        f.write(HEADER.pack(MAGIC, VERSION, rows, block_rows, len(names)))
+        for name, array, data_offset in zip(names, arrays, offsets):
+            f.write(COLUMN.pack(name.encode(), array.dtype.str.encode(), data_offset))
+        f.write(index.tobytes())
+        for array, data_offset in zip(arrays, offsets):
+            f.write(b'\0' * (data_offset - f.tell()))
+            f.write(array.tobytes())
+
+
+class Archive:
+    """Memory-mapped reader of the columnar archive"""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            magic, version, self.rows, self.block_rows, count = HEADER.unpack(f.read(HEADER.size))
+            if magic != MAGIC or version != VERSION:
+                raise ValueError('Not a MQ131 archive (version %d)' % VERSION)
+            descriptions = [COLUMN.unpack(f.read(COLUMN.size)) for _ in range(count)]
+        self.names = [name.rstrip(b'\0').decode() for name, _, _ in descriptions]
+        blocks = (self.rows + self.block_rows - 1) // self.block_rows
+        self.index = np.memmap(path, dtype='<f8', mode='r',
+                               offset=HEADER.size + COLUMN.size * count,
+                               shape=(blocks, count, 2))
+        self.columns = {}
+        for name, (_, dtype, data_offset) in zip(self.names, descriptions):
+            self.columns[name] = np.memmap(path, dtype=np.dtype(dtype.rstrip(b'\0').decode()),
+                                           mode='r', offset=data_offset, shape=(self.rows,))
+
+    def scan(self, start, end, names=None):
+        """Rows with start <= timestamp < end, as views on the file (no copy)
+        Blocks outside of the range are skipped with the index"""
+        t = self.names.index('timestamp')
+        blocks = np.nonzero((self.index[:, t, 1] >= start) & (self.index[:, t, 0] < end))[0]
+        if len(blocks) == 0:
+            return {name: self.columns[name][0:0] for name in (names or self.names)}
+        first = blocks[0] * self.block_rows
+        last = min((blocks[-1] + 1) * self.block_rows, self.rows)
+        timestamps = self.columns['timestamp'][first:last]
+        low = first + np.searchsorted(timestamps, start, side='left')
+        high = first + np.searchsorted(timestamps, end, side='left')
+        return {name: self.columns[name][low:high] for name in (names or self.names)}
+
+
+def encode_log(sequences, timestamps, ppb, adc, rl, supply, load_resistor=0):
+    """Same records as MQ131LogClass (for tests and benchmarks)"""
+    records = np.zeros(len(sequences), dtype=LOG_RECORD)
+    records['sequence'] = sequences
+    records['timestamp'] = timestamps
+    records['ppb'] = ppb
+    records['adc'] = adc
+    records['load_resistor'] = load_resistor
+    records['rl'] = rl
+    records['supply'] = supply
+    rows = records.view(np.uint8).reshape(-1, LOG_RECORD.itemsize)
+    records['crc'] = crc16(rows[:, :LOG_RECORD.itemsize - 2])
+    return records
+
+
+if __name__ == '__main__':
+    import os
+    import sys
+    import tempfile
+    import time
+
+    if 3 <= len(sys.argv) <= 4:
+        environment = read_environment(sys.argv[3]) if len(sys.argv) > 3 else None
+        write_archive(sys.argv[2], read_log(sys.argv[1], environment=environment))
+        archive = Archive(sys.argv[2])
+        print('%d readings archived' % archive.rows)
+        sys.exit(0)
+    if len(sys.argv) != 1:
+        print('Usage: %s <log dump> <archive> [environment csv]' % sys.argv[0])
+        sys.exit(1)
+
+    # Benchmark: dump of 65536 records (one per minute) with erased slots
+    # and torn records, three load resistors and a measured supply,
+    # environment every 10 minutes
+    count = 65536
+    sequences = np.arange(count, dtype=np.uint32)
+    load_resistors = np.array([1000, 10000, 100000], dtype=np.uint32)
+    records = encode_log(sequences, 1700000000 + 60 * sequences, 20 + (sequences % 50) * 0.5,
+                         300 + sequences % 200, load_resistors[sequences % 3], 1000 + sequences % 40,
+                         sequences % 3)
+    records['crc'][::1000] ^= 1
+    raw = np.concatenate([records.view(np.uint8), np.full(4096, 0xFF, dtype=np.uint8)])
+    with tempfile.TemporaryDirectory() as directory:
+        dump = os.path.join(directory, 'log.bin')
+        raw.tofile(dump)
+        env = os.path.join(directory, 'environment.csv')
+        env_timestamps = 1700000000 + 600 * np.arange(count // 10)
+        np.savetxt(env, np.column_stack([env_timestamps, 20 + env_timestamps % 7, 50 + env_timestamps % 11]),
+                   delimiter=',', header='timestamp,temperature,humidity', comments='', fmt='%d')
+
+        begin = time.perf_counter()
+        columns = read_log(dump, environment=read_environment(env))
+        read_time = time.perf_counter() - begin
+        path = os.path.join(directory, 'readings.col')
+        begin = time.perf_counter()
+        write_archive(path, columns)
+        write_time = time.perf_counter() - begin
+        archive = Archive(path)
+        begin = time.perf_counter()
+        rows = archive.scan(1700000000 + 3600, 1700000000 + 7200)
+        scan_time = time.perf_counter() - begin
+        print('%d/%d records read in %.1f ms, archived in %.1f ms, %d rows scanned in %.2f ms (columns: %s)'
+              % (archive.rows, count, 1000 * read_time, 1000 * write_time, len(rows['timestamp']),
+                 1000 * scan_time, ', '.join(archive.names)))
+
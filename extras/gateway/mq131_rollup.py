@@ -0,0 +1,293 @@
+# Multi-resolution rollup of MQ131 readings for time-range aggregates
+#
+# Each reading updates one bucket per resolution (min, max, sum, count).
+# A query over [start, end[ takes the coarsest buckets fully inside the
+# range and only goes down to finer resolutions on the edges, so the cost
+# depends on the number of resolutions, not on the number of readings.
+# The finest resolution defines the precision of the range (edges are
+# aligned on it).
+#
+# Above the coarsest resolution, levels with a fan-out of TREE_FANOUT are
+# added until one bucket covers the whole 32-bit timestamp range (a tree):
+# a query touches less than one fan-out of buckets per level and per edge,
+# whatever the span of the range.
+#
+# The fine levels have a retention: their buckets older than the retention
+# (from the last timestamp added) are dropped, so the memory of a fleet is
+# bounded over the years (only the coarse levels grow, one bucket per 30
+# days). On a range older than the retention of a level, its edges are
+# aligned on the next coarser level kept.
+#
+# A bucket holds the aggregates of all the sensors in arrays (one column
+# per sensor), so a batch of readings (e.g. the frames decoded by
+# mq131_ingest.py) updates each level with a few numpy operations.
+
+import math
+import numpy as np
+
+# Resolutions in seconds (each one a multiple of the previous):
+# minute, hour, day, 30 days
+DEFAULT_RESOLUTIONS = (60, 3600, 86400, 30 * 86400)
+
+# Retention of each resolution in seconds (None: kept forever):
+# 2 days of minutes, 90 days of hours, 2 years of days
+DEFAULT_RETENTIONS = (2 * 86400, 90 * 86400, 2 * 365 * 86400, None)
+
+# Fan-out of the levels above the coarsest resolution
+TREE_FANOUT = 16
+
+# Span of the timestamps (seconds on 32 bits)
+TIMESTAMP_SPAN = 1 << 32
+
+# Period of the compaction (seconds of timestamps)
+COMPACTION_PERIOD = 3600
+
+# Rows of a bucket
+MINIMUM, MAXIMUM, TOTAL, COUNT = range(4)
+
+
+class Aggregate:
+    """Min, max, mean and count of a set of readings"""
+
+    __slots__ = ('minimum', 'maximum', 'total', 'count')
+
+    def __init__(self):
+        self.minimum = math.inf
+        self.maximum = -math.inf
+        self.total = 0.0
+        self.count = 0
+
+    def add(self, value):
+        self.minimum = min(self.minimum, value)
+        self.maximum = max(self.maximum, value)
+        self.total += value
+        self.count += 1
+
+    def merge(self, other):
+        self.minimum = min(self.minimum, other.minimum)
+        self.maximum = max(self.maximum, other.maximum)
+        self.total += other.total
+        self.count += other.count
+
+    def merge_bucket(self, bucket, column=None):
+        """Merge one column of a bucket (None: all the columns)"""
+        if column is None:
+            self.minimum = min(self.minimum, bucket[MINIMUM].min())
+            self.maximum = max(self.maximum, bucket[MAXIMUM].max())
+            self.total += bucket[TOTAL].sum()
+            self.count += int(bucket[COUNT].sum())
+        elif column < bucket.shape[1]:
+            self.minimum = min(self.minimum, bucket[MINIMUM, column])
+            self.maximum = max(self.maximum, bucket[MAXIMUM, column])
+            self.total += bucket[TOTAL, column]
+            self.count += int(bucket[COUNT, column])
+
+    @property
+    def mean(self):
+        return self.total / self.count if self.count else math.nan
+
+    def __repr__(self):
+        return 'min=%.2f max=%.2f mean=%.2f count=%d' % (self.minimum, self.maximum, self.mean, self.count)
+
+
+def new_bucket(columns):
+    """Empty bucket (rows: min, max, total, count)"""
+    bucket = np.zeros((4, columns))
+    bucket[MINIMUM] = math.inf
+    bucket[MAXIMUM] = -math.inf
+    return bucket
+
+
+class Pyramid:
+    """Rollup of several series (columns) at several resolutions"""
+
+    def __init__(self, resolutions=DEFAULT_RESOLUTIONS, retentions=DEFAULT_RETENTIONS):
+        if len(retentions) != len(resolutions):
+            raise ValueError('One retention per resolution')
+        for finer, coarser in zip(resolutions, resolutions[1:]):
+            if coarser % finer:
+                raise ValueError('Each resolution must be a multiple of the previous one')
+        # Tree above the coarsest resolution (kept forever)
+        resolutions = list(resolutions)
+        retentions = list(retentions)
+        while resolutions[-1] < TIMESTAMP_SPAN:
+            resolutions.append(resolutions[-1] * TREE_FANOUT)
+            retentions.append(None)
+        self.resolutions = resolutions
+        self.retentions = retentions
+        self.levels = [dict() for _ in resolutions]
+        # First timestamp kept by each level
+        self.horizons = [0] * len(resolutions)
+        self.latest = 0
+        self.compacted = 0
+
+    def add(self, columns, timestamps, values):
+        """Add readings (arrays of the same length: column of the series,
+        timestamp, value)"""
+        columns = np.asarray(columns, dtype=np.int64)
+        timestamps = np.asarray(timestamps, dtype=np.int64)
+        values = np.asarray(values, dtype=np.float64)
+        if len(timestamps) == 0:
+            return
+        width_columns = int(columns.max()) + 1
+        for width, buckets, horizon in zip(self.resolutions, self.levels, self.horizons):
+            keep = timestamps >= horizon
+            keys = timestamps[keep] // width
+            order = np.argsort(keys, kind='stable')
+            keys = keys[order]
+            level_columns = columns[keep][order]
+            level_values = values[keep][order]
+            # One update per bucket of the batch
+            bounds = np.concatenate([[0], np.flatnonzero(np.diff(keys)) + 1, [len(keys)]])
+            for first, last in zip(bounds[:-1], bounds[1:]):
+                if first == last:
+                    continue
+                key = int(keys[first])
+                bucket = buckets.get(key)
+                if bucket is None:
+                    bucket = buckets[key] = new_bucket(width_columns)
+                elif bucket.shape[1] < width_columns:
+                    bucket = buckets[key] = np.concatenate([bucket, new_bucket(width_columns - bucket.shape[1])],
+                                                           axis=1)
+                selected = level_columns[first:last]
+                np.minimum.at(bucket[MINIMUM], selected, level_values[first:last])
+                np.maximum.at(bucket[MAXIMUM], selected, level_values[first:last])
+                np.add.at(bucket[TOTAL], selected, level_values[first:last])
+                np.add.at(bucket[COUNT], selected, 1)
+        self.latest = max(self.latest, int(timestamps.max()))
+        if self.latest // COMPACTION_PERIOD != self.compacted:
+            self.compact()
+
+    def compact(self):
+        """Drop the buckets older than the retention of their level"""
+        self.compacted = self.latest // COMPACTION_PERIOD
+        for level, (width, retention, buckets) in enumerate(zip(self.resolutions, self.retentions, self.levels)):
+            if retention is None:
+                continue
+            limit = max(0, self.latest - retention) // width
+            for key in [key for key in buckets if key < limit]:
+                del buckets[key]
+            self.horizons[level] = max(self.horizons[level], limit * width)
+
+    def get_bucket_count(self):
+        return sum(len(buckets) for buckets in self.levels)
+
+    def get_memory(self):
+        """Bytes of the buckets (arrays only)"""
+        return sum(bucket.nbytes for buckets in self.levels for bucket in buckets.values())
+
+    def query(self, start, end, column=None):
+        """Aggregate of a column (None: all the columns) over [start, end["""
+        result = Aggregate()
+        self._query(len(self.levels) - 1, start, end, column, result)
+        return result
+
+    def _query(self, level, start, end, column, result):
+        if start >= end:
+            return
+        width = self.resolutions[level]
+        buckets = self.levels[level]
+        if level > 0 and start < self.horizons[level - 1]:
+            # Part dropped from the finer level: partial buckets on the edge
+            # (up to the first bucket boundary after the horizon)
+            split = min(end, -(-self.horizons[level - 1] // width) * width)
+            for key in range(start // width, -(-split // width)):
+                if key in buckets:
+                    result.merge_bucket(buckets[key], column)
+            start = split
+            if start >= end:
+                return
+        if level == 0:
+            # Finest resolution: partial buckets on the edges are included
+            for key in range(start // width, -(-end // width)):
+                if key in buckets:
+                    result.merge_bucket(buckets[key], column)
+            return
+        first = -(-start // width)
+        last = end // width
+        if first >= last:
+            self._query(level - 1, start, end, column, result)
+            return
+        # Less than one fan-out of buckets (one bucket at the top)
+        for key in range(first, last):
+            if key in buckets:
+                result.merge_bucket(buckets[key], column)
+        self._query(level - 1, start, first * width, column, result)
+        self._query(level - 1, last * width, end, column, result)
+
+
+class RollupStore:
+    """Rollup of a fleet of sensors (per sensor and for the whole fleet)"""
+
+    def __init__(self, resolutions=DEFAULT_RESOLUTIONS, retentions=DEFAULT_RETENTIONS):
+        self.pyramid = Pyramid(resolutions, retentions)
+        self.columns = {}
+
+    def _get_columns(self, sensors):
+        columns = np.empty(len(sensors), dtype=np.int64)
+        for i, sensor in enumerate(sensors):
+            column = self.columns.get(sensor)
+            if column is None:
+                column = self.columns[sensor] = len(self.columns)
+            columns[i] = column
+        return columns
+
+    def add(self, sensor, timestamp, ppb):
+        self.pyramid.add([self._get_columns([sensor])[0]], [timestamp], [ppb])
+
+    def add_batch(self, sensors, timestamps, ppb):
+        """Add arrays of readings (e.g. fields of the frames of mq131_ingest.py)"""
+        sensors = np.asarray(sensors)
+        identifiers, inverse = np.unique(sensors, return_inverse=True)
+        columns = self._get_columns(identifiers.tolist())[inverse]
+        self.pyramid.add(columns, timestamps, ppb)
+
+    def query(self, start, end, sensor=None):
+        if sensor is None:
+            return self.pyramid.query(start, end)
+        column = self.columns.get(sensor)
+        return self.pyramid.query(start, end, column) if column is not None else Aggregate()
+
+
+if __name__ == '__main__':
+    # Benchmark over a synthetic fleet (daily cycle of ozone with noise),
+    # readings added in batches of one period for the whole fleet
+    import random
+    import resource
+    import sys
+    import time
+
+    sensors = int(sys.argv[1]) if len(sys.argv) > 1 else 1000
+    years = int(sys.argv[2]) if len(sys.argv) > 2 else 2
+    period = int(sys.argv[3]) if len(sys.argv) > 3 else 900
+    random.seed(0)
+    generator = np.random.default_rng(0)
+
+    store = RollupStore()
+    duration = years * 365 * 86400
+    identifiers = np.arange(sensors)
+    begin = time.perf_counter()
+    readings = 0
+    for timestamp in range(0, duration, period):
+        daily = 30 + 25 * math.sin(2 * math.pi * (timestamp % 86400) / 86400)
+        values = np.maximum(0.0, daily + generator.normal(0, 5, sensors))
+        store.add_batch(identifiers, np.full(sensors, timestamp), values)
+        readings += sensors
+    elapsed = time.perf_counter() - begin
+    print('%d readings of %d sensors ingested in %.1f s (%.0f readings/s)'
+          % (readings, sensors, elapsed, readings / elapsed))
+    print('%d buckets, %.1f MB of aggregates, max resident memory %.0f MB'
+          % (store.pyramid.get_bucket_count(), store.pyramid.get_memory() / 1e6,
+             resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024))
+
+    queries = 1000
+    for sensor in (None, sensors // 2):
+        begin = time.perf_counter()
+        for _ in range(queries):
+            start = random.randrange(0, duration)
+            end = random.randrange(start, duration + 1)
+            store.query(start, end, sensor)
+        elapsed = time.perf_counter() - begin
+        print('%d random range queries on %s in %.3f s (%.0f us/query)'
+              % (queries, 'the fleet' if sensor is None else 'one sensor', elapsed, elapsed / queries * 1e6))
+    print('Whole period: %s' % store.query(0, duration))
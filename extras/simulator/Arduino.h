@@ -0,0 +1,93 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Minimal Arduino API to build the driver on a host (simulator)              *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+// Only the part of the Arduino API used by the driver is provided. The pins
+// and the clock are not available on the host: each simulated sensor gives
+// its own MQ131Hal to the driver (setHal()), the functions below are never
+// called by the simulator
+
+#ifndef _MQ131_SIMULATOR_ARDUINO_H_
+#define _MQ131_SIMULATOR_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+#define F(string) (string)
+#define PROGMEM
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int analogRead(uint8_t) { return 0; }
+inline unsigned long millis() { return 0; }
+inline void delay(unsigned long) {}
+
+// Output stream (print functions on top of write())
+class Stream {
+	public:
+		virtual ~Stream() {}
+
+		virtual size_t write(uint8_t value) = 0;
+		virtual size_t write(const uint8_t* buffer, size_t size) {
+			size_t count = 0;
+			while(count < size && write(buffer[count])) {
+				count++;
+			}
+			return count;
+		}
+
+		size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+		size_t print(int value) { return format("%d", value); }
+		size_t print(unsigned int value) { return format("%u", value); }
+		size_t print(long value) { return format("%ld", value); }
+		size_t print(unsigned long value) { return format("%lu", value); }
+		size_t print(double value, int digits = 2) { return format("%.*f", digits, value); }
+
+		size_t println() { return print("\r\n"); }
+		template<typename T> size_t println(T value) { return print(value) + println(); }
+		template<typename T> size_t println(T value, int digits) { return print(value, digits) + println(); }
+
+	private:
+		template<typename... T> size_t format(const char* pattern, T... values) {
+			char text[32];
+			snprintf(text, sizeof(text), pattern, values...);
+			return print(text);
+		}
+};
+
+#endif // _MQ131_SIMULATOR_ARDUINO_H_
@@ -0,0 +1,191 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * File-backed storage of the log for host tests (host only)                  *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#include "MQ131FileStorage.h"
+
+/**
+ * Constructor, nothing special to do
+ */
+MQ131FileStorage::MQ131FileStorage() {
+}
+
+/**
+ * Destructor, close the file
+ */
+MQ131FileStorage::~MQ131FileStorage() {
+  end();
+}
+
+/**
+ * Open the file, or create it if missing
+ */
+bool MQ131FileStorage::begin(const char* path, uint32_t _size, uint16_t _pageSize, uint32_t _eraseSize) {
+  end();
+  file = fopen(path, "r+b");
+  if(file == NULL) {
+    file = fopen(path, "w+b");
+  }
+  size = _size;
+  pageSize = _pageSize;
+  eraseSize = _eraseSize;
+  readCount = 0;
+  return file != NULL;
+}
+
+/**
+ * Close the file
+ */
+void MQ131FileStorage::end() {
+  if(file != NULL) {
+    fclose(file);
+    file = NULL;
+  }
+}
+
+/**
+ * Get the size of the storage
+ */
+uint32_t MQ131FileStorage::getSize() {
+  return size;
+}
+
+/**
+ * Get the size of a program page
+ */
+uint16_t MQ131FileStorage::getPageSize() {
+  return pageSize;
+}
+
+/**
+ * Get the size of an erase block
+ */
+uint32_t MQ131FileStorage::getEraseSize() {
+  return eraseSize;
+}
+
+/**
+ * Read bytes, erased (0xFF) past the end of the file
+ */
+bool MQ131FileStorage::read(uint32_t address, uint8_t* data, uint16_t length) {
+  if(file == NULL || address + length > size) {
+    return false;
+  }
+  readCount++;
+  memset(data, 0xFF, length);
+  if(fseek(file, address, SEEK_SET) != 0) {
+    return false;
+  }
+  size_t count = fread(data, 1, length, file);
+  // Past the end of the file: keep the erased bytes
+  if(count < length) {
+    memset(&data[count], 0xFF, length - count);
+  }
+  return true;
+}
+
+/**
+ * Program bytes inside one page (bits can only be cleared)
+ */
+bool MQ131FileStorage::write(uint32_t address, const uint8_t* data, uint16_t length) {
+  if(file == NULL || address + length > size || length == 0
+     || address / pageSize != (address + length - 1) / pageSize) {
+    return false;
+  }
+  if(!extend(address + length)) {
+    return false;
+  }
+  // By chunks: read the current bytes, clear the bits and write back
+  uint8_t current[64];
+  for(uint16_t done = 0; done < length; done += sizeof(current)) {
+    uint16_t count = length - done < (uint16_t)sizeof(current) ? length - done : sizeof(current);
+    if(fseek(file, address + done, SEEK_SET) != 0 || fread(current, 1, count, file) != count) {
+      return false;
+    }
+    for(uint16_t i = 0; i < count; i++) {
+      current[i] &= data[done + i];
+    }
+    if(fseek(file, address + done, SEEK_SET) != 0 || fwrite(current, 1, count, file) != count) {
+      return false;
+    }
+  }
+  return fflush(file) == 0;
+}
+
+/**
+ * Erase the block containing the address
+ */
+bool MQ131FileStorage::erase(uint32_t address) {
+  if(file == NULL || address >= size) {
+    return false;
+  }
+  uint8_t erased[256];
+  memset(erased, 0xFF, sizeof(erased));
+  uint32_t block = address - address % eraseSize;
+  if(!extend(block) || fseek(file, block, SEEK_SET) != 0) {
+    return false;
+  }
+  for(uint32_t done = 0; done < eraseSize; done += sizeof(erased)) {
+    uint32_t length = eraseSize - done < sizeof(erased) ? eraseSize - done : sizeof(erased);
+    if(fwrite(erased, 1, length, file) != length) {
+      return false;
+    }
+  }
+  return fflush(file) == 0;
+}
+
+/**
+ * Fill the end of the file with erased bytes (a hole would read 0x00)
+ */
+bool MQ131FileStorage::extend(uint32_t length) {
+  if(fseek(file, 0, SEEK_END) != 0) {
+    return false;
+  }
+  long current = ftell(file);
+  if(current < 0) {
+    return false;
+  }
+  uint8_t erased[256];
+  memset(erased, 0xFF, sizeof(erased));
+  while((uint32_t)current < length) {
+    uint32_t count = length - current < (uint32_t)sizeof(erased) ? length - current : sizeof(erased);
+    if(fwrite(erased, 1, count, file) != count) {
+      return false;
+    }
+    current += count;
+  }
+  return true;
+}
+
+/**
+ * Get the number of reads since begin()
+ */
+uint32_t MQ131FileStorage::getReadCount() {
+  return readCount;
+}
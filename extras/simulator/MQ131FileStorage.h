@@ -0,0 +1,78 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * File-backed storage of the log for host tests (host only)                  *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#ifndef _MQ131_FILE_STORAGE_H_
+#define _MQ131_FILE_STORAGE_H_
+
+#include <Arduino.h>
+#include "MQ131Log.h"
+
+// Storage of MQ131LogClass in a file (image of a NOR flash):
+// - the bytes past the end of the file read as erased (0xFF), so a
+//   truncated file looks like a flash whose last writes were lost
+// - programming only clears bits (new = old & data), inside one page
+// - erasing a block sets its bytes to 0xFF
+// Each operation goes to the file at once (no cache), so the file can be
+// truncated or corrupted between two begin() of the log
+class MQ131FileStorage : public MQ131LogStorage {
+	public:
+		// Constructor
+		MQ131FileStorage();
+		virtual ~MQ131FileStorage();
+
+		// Open the file (created if missing) with the geometry of the flash
+		bool begin(const char* path, uint32_t _size, uint16_t _pageSize, uint32_t _eraseSize);
+		void end();
+
+		// Geometry of the storage
+		uint32_t getSize();
+		uint16_t getPageSize();
+		uint32_t getEraseSize();
+
+		// Read, program (inside one page) and erase (one block)
+		bool read(uint32_t address, uint8_t* data, uint16_t length);
+		bool write(uint32_t address, const uint8_t* data, uint16_t length);
+		bool erase(uint32_t address);
+
+		// Number of reads since begin() (cost of the recovery)
+		uint32_t getReadCount();
+
+	private:
+		// Fill the file with erased bytes up to the given length
+		bool extend(uint32_t length);
+
+		FILE* file = NULL;
+		uint32_t size = 0;
+		uint16_t pageSize = 0;
+		uint32_t eraseSize = 0;
+		uint32_t readCount = 0;
+};
+
+#endif // _MQ131_FILE_STORAGE_H_
@@ -0,0 +1,259 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Physical model of the MQ131 element for simulation (host only)             *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#include "MQ131SensorModel.h"
+
+/**
+ * Constructor, nothing special to do
+ */
+MQ131SensorModel::MQ131SensorModel() {
+}
+
+/**
+ * Destructor, nothing special to do
+ */
+MQ131SensorModel::~MQ131SensorModel() {
+}
+
+/**
+ * Initialize the element and its circuit
+ */
+void MQ131SensorModel::begin(uint8_t _pinPower, uint8_t _pinSensor, MQ131Model _model, uint32_t _RL,
+                             float _valueR0, uint32_t seed) {
+  pinPower = _pinPower;
+  pinSensor = _pinSensor;
+  valueRL = _RL;
+  valueR0 = _valueR0;
+  random = seed != 0 ? seed : 1;
+
+  // Take the curve from the driver itself (same constants as getO3())
+  MQ131Class reference(_RL);
+  reference.setHal(this);
+  reference.begin(_pinPower, _pinSensor, _model, _RL);
+  curveA = reference.getCurveA();
+  curveB = reference.getCurveB();
+  unitFactor = _model == HIGH_CONCENTRATION ? 0.001 : 1.0;
+
+  // Cold element at ambient temperature, in equilibrium with the gas
+  heaterOn = false;
+  lastUpdateMs = clockMs;
+  elementKelvin = temperatureCelsius + 273.15;
+  concentrationSeen = concentration;
+}
+
+/**
+ * Define the concentration of ozone around the element (ppb)
+ */
+void MQ131SensorModel::setO3(float ppb) {
+  update();
+  concentration = ppb;
+}
+
+/**
+ * Define the environment around the element
+ */
+void MQ131SensorModel::setEnv(float tempCels, float humPc) {
+  update();
+  temperatureCelsius = tempCels;
+  humidityPercent = humPc;
+}
+
+/**
+ * Define the noise on Rs (relative standard deviation)
+ */
+void MQ131SensorModel::setNoise(float _noise) {
+  noise = _noise;
+}
+
+/**
+ * Define the drift of R0 (relative, per day)
+ */
+void MQ131SensorModel::setDrift(float _driftPerDay) {
+  driftPerDay = _driftPerDay;
+}
+
+/**
+ * Define the thermal dynamics of the element
+ */
+void MQ131SensorModel::setThermal(float _heaterTau, float _activationEV) {
+  heaterTau = _heaterTau;
+  activationEV = _activationEV;
+}
+
+/**
+ * Get R0 of the element at the current time (with the drift)
+ */
+float MQ131SensorModel::getR0() {
+  return valueR0 * (1.0 + driftPerDay * clockMs / 86400000.0);
+}
+
+/**
+ * Get Rs of the element at the current time (without noise)
+ */
+float MQ131SensorModel::getRs() {
+  update();
+
+  // Curve of the driver in reverse, at the reference environment
+  float native = concentrationSeen * unitFactor;
+  if(native < MQ131_MODEL_MIN_CONCENTRATION) {
+    native = MQ131_MODEL_MIN_CONCENTRATION;
+  }
+  float ratio = pow(native / curveA, 1.0 / curveB) * getEnvFactor();
+
+  // Conduction is thermally activated: a colder element has a higher Rs
+  float heatedKelvin = temperatureCelsius + 273.15 + MQ131_MODEL_HEATER_RISE;
+  float thermal = exp(activationEV / MQ131_MODEL_BOLTZMANN_EV * (1.0 / elementKelvin - 1.0 / heatedKelvin));
+
+  return getR0() * ratio * thermal;
+}
+
+/**
+ * Get the temperature of the element (Celsius)
+ */
+float MQ131SensorModel::getElementTemperature() {
+  update();
+  return elementKelvin - 273.15;
+}
+
+/**
+ * Let the virtual time run until the given time
+ */
+void MQ131SensorModel::waitUntil(uint32_t ms) {
+  if(ms > clockMs) {
+    clockMs = ms;
+  }
+}
+
+/**
+ * Pins are not configured on the model
+ */
+void MQ131SensorModel::setPinMode(uint8_t, uint8_t) {
+}
+
+/**
+ * Switch the heater
+ */
+void MQ131SensorModel::writePin(uint8_t pin, uint8_t value) {
+  if(pin == pinPower) {
+    update();
+    heaterOn = value == HIGH;
+  }
+}
+
+/**
+ * Read the voltage on the load resistance (ADC code)
+ */
+uint16_t MQ131SensorModel::readAnalog(uint8_t pin) {
+  if(pin != pinSensor) {
+    return 0;
+  }
+  float rs = getRs() * (1.0 + noise * nextGaussian());
+  if(rs < 0) {
+    rs = 0;
+  }
+  float code = (float)MQ131_ADC_STEPS * valueRL / (valueRL + rs);
+  if(code >= MQ131_ADC_STEPS - 1) {
+    return MQ131_ADC_STEPS - 1;
+  }
+  return (uint16_t)code;
+}
+
+/**
+ * Get the virtual time (ms)
+ */
+uint32_t MQ131SensorModel::getMillis() {
+  return clockMs;
+}
+
+/**
+ * Move the virtual time forward
+ */
+void MQ131SensorModel::wait(uint32_t ms) {
+  clockMs += ms;
+}
+
+/**
+ * Bring the element to the current time (exact solution of the
+ * first-order lags, whatever the time step)
+ */
+void MQ131SensorModel::update() {
+  float elapsed = (clockMs - lastUpdateMs) / 1000.0;
+  lastUpdateMs = clockMs;
+  if(elapsed <= 0) {
+    return;
+  }
+
+  float targetKelvin = temperatureCelsius + 273.15 + (heaterOn ? MQ131_MODEL_HEATER_RISE : 0);
+  elementKelvin = targetKelvin + (elementKelvin - targetKelvin) * exp(-elapsed / heaterTau);
+  concentrationSeen = concentration + (concentrationSeen - concentration) * exp(-elapsed / MQ131_MODEL_GAS_TAU);
+}
+
+/**
+ * Scale of Rs/R0 due to temperature and humidity
+ * (datasheet curves at 30%, 60% and 85%, relative to 20°C 60%)
+ */
+float MQ131SensorModel::getEnvFactor() {
+  float dry = -0.0141 * temperatureCelsius + 1.5623;
+  float medium = -0.0119 * temperatureCelsius + 1.3261;
+  float humid = -0.0103 * temperatureCelsius + 1.1507;
+
+  // Same interpolation and normalization as the correction of the driver
+  float factor;
+  if(humidityPercent <= 30) {
+    factor = dry;
+  } else if(humidityPercent < 60) {
+    factor = dry + (medium - dry) * (humidityPercent - 30) / 30.0;
+  } else if(humidityPercent < 85) {
+    factor = medium + (humid - medium) * (humidityPercent - 60) / 25.0;
+  } else {
+    factor = humid;
+  }
+  float reference = -0.0119 * 20 + 1.3261;
+  return factor / reference;
+}
+
+/**
+ * Uniform random number in [0, 1[
+ */
+float MQ131SensorModel::nextUniform() {
+  random ^= random << 13;
+  random ^= random >> 17;
+  random ^= random << 5;
+  return (random & 0xFFFFFF) / 16777216.0;
+}
+
+/**
+ * Gaussian random number (Box-Muller)
+ */
+float MQ131SensorModel::nextGaussian() {
+  float u = 1.0 - nextUniform();
+  float v = nextUniform();
+  return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
@@ -0,0 +1,139 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Physical model of the MQ131 element for simulation (host only)             *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#ifndef _MQ131_SENSOR_MODEL_H_
+#define _MQ131_SENSOR_MODEL_H_
+
+#include <Arduino.h>
+#include "MQ131.h"
+
+// Default parameters of the model
+#define MQ131_MODEL_HEATER_RISE                     280.0             // Temperature of the heated element above ambient (K)
+#define MQ131_MODEL_HEATER_TAU                      20.0              // Thermal time constant of the element (s)
+#define MQ131_MODEL_ACTIVATION_EV                   0.2               // Activation energy of the conduction (eV)
+#define MQ131_MODEL_GAS_TAU                         8.0               // Time constant of the gas response (s)
+#define MQ131_MODEL_DEFAULT_NOISE                   0.005             // Relative noise on Rs (standard deviation)
+#define MQ131_MODEL_BOLTZMANN_EV                    8.617333e-5       // Boltzmann constant (eV/K)
+#define MQ131_MODEL_MIN_CONCENTRATION               0.1               // Lowest concentration seen by the element (native unit)
+
+// Model of the element and circuit, seen by the driver through its pins
+// and clock (give it to the driver with setHal()):
+// - the element temperature follows the heater with a first-order lag
+// - Rs follows the curve of the driver in reverse (getO3() gives back the
+//   concentration at the reference environment 20°C 60%), with a
+//   first-order lag on the gas
+// - Rs rises when the element is colder than the heated temperature
+//   (thermally activated conduction, exp(Ea / kT))
+// - temperature and humidity scale Rs/R0 along the datasheet curves
+//   (30%, 60% and 85%, interpolated on the humidity): Rs is higher when
+//   colder or drier, the driver divides by the same curves
+// - R0 drifts linearly with time, Rs has a gaussian noise
+// - the ADC code is quantized and saturated as on the board
+class MQ131SensorModel : public MQ131Hal {
+	public:
+		// Constructor
+		MQ131SensorModel();
+		virtual ~MQ131SensorModel();
+
+		// Initialize the element (same pins, model and load resistance as the
+		// driver); the seed makes the noise reproducible
+		void begin(uint8_t _pinPower, uint8_t _pinSensor, MQ131Model _model, uint32_t _RL,
+		           float _valueR0, uint32_t seed);
+
+		// Scenario: concentration (ppb) and environment around the element
+		void setO3(float ppb);
+		void setEnv(float tempCels, float humPc);
+
+		// Imperfections: noise (relative std dev) and drift of R0 (per day,
+		// e.g. 0.001 = +0.1% per day)
+		void setNoise(float _noise);
+		void setDrift(float _driftPerDay);
+
+		// Dynamics: thermal time constant (s) and activation energy (eV)
+		void setThermal(float _heaterTau, float _activationEV);
+
+		// True state of the element (at the current virtual time)
+		float getR0();
+		float getRs();
+		float getElementTemperature();
+
+		// Virtual clock: let the time run until the given time (ms)
+		void waitUntil(uint32_t ms);
+
+		// Pins and clock for the driver
+		void setPinMode(uint8_t pin, uint8_t mode);
+		void writePin(uint8_t pin, uint8_t value);
+		uint16_t readAnalog(uint8_t pin);
+		uint32_t getMillis();
+		void wait(uint32_t ms);
+
+	private:
+		// Bring the thermal and gas states to the current time
+		void update();
+
+		// Scale of Rs/R0 due to the environment (1.0 at 20°C 60%)
+		float getEnvFactor();
+
+		// Random numbers (xorshift, reproducible)
+		float nextUniform();
+		float nextGaussian();
+
+		// Circuit
+		uint8_t pinPower = -1;
+		uint8_t pinSensor = -1;
+		uint32_t valueRL = 0;
+
+		// Curve of the driver in the native unit (ppb or ppm)
+		float curveA = 1;
+		float curveB = 1;
+		float unitFactor = 1;
+
+		// Element
+		float valueR0 = 0;
+		float driftPerDay = 0;
+		float noise = MQ131_MODEL_DEFAULT_NOISE;
+		float heaterTau = MQ131_MODEL_HEATER_TAU;
+		float activationEV = MQ131_MODEL_ACTIVATION_EV;
+
+		// Scenario
+		float concentration = 0;
+		float temperatureCelsius = 20;
+		float humidityPercent = 60;
+
+		// State
+		uint32_t clockMs = 0;
+		uint32_t lastUpdateMs = 0;
+		bool heaterOn = false;
+		float elementKelvin = 293.15;
+		float concentrationSeen = 0;
+		uint32_t random = 1;
+};
+
+#endif // _MQ131_SENSOR_MODEL_H_
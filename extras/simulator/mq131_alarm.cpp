@@ -0,0 +1,135 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Early warning of the alarm on the warm-up of the sensor model (host only)  *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+// Run MQ131AlarmClass::sample() on MQ131SensorModel (element heated from
+// ambient at each cycle, noise and quantization of the ADC) for every model:
+// - above: the ozone is 1.5 times the threshold, the early warning must be
+//   raised during the warm-up, before the final reading, and confirmed by it
+// - below: the ozone is 0.7 times the threshold, no early warning may be
+//   raised
+// Several cycles are run, with the element cooling down in between (new
+// alarm at each cycle, as an active alarm has no early warning). The
+// time of the early warning and of the final reading are printed for each
+// cycle; the exit code is 1 if a check fails.
+//
+// Build and run (from this directory):
+//   g++ -O2 -std=c++11 -I. -I../../src ../../src/*.cpp MQ131SensorModel.cpp mq131_alarm.cpp -o mq131_alarm
+//   ./mq131_alarm
+
+#include <stdlib.h>
+
+#include "MQ131.h"
+#include "MQ131Alarm.h"
+#include "MQ131SensorModel.h"
+
+#define ALARM_PIN_POWER                             2
+#define ALARM_PIN_SENSOR                            14
+#define ALARM_RL                                    10000             // Load resistance (Ohms)
+#define ALARM_CYCLES                                3                 // Cycles of each scenario
+#define ALARM_PAUSE_MS                              600000            // Heater off between two cycles (element back to ambient)
+#define ALARM_ABOVE                                 1.5               // Ozone of the scenario above the threshold (ratio)
+#define ALARM_BELOW                                 0.7               // Ozone of the scenario below the threshold (ratio)
+
+// Notifications of the alarm in the current cycle
+static MQ131SensorModel* clockSource = NULL;
+static int32_t earlyMs = -1;
+static bool cancelled = false;
+
+/**
+ * Callback of the alarm: time of the early warning, cancellations
+ */
+static void onAlarm(uint8_t level, bool early) {
+	if(early && earlyMs < 0) {
+		earlyMs = clockSource->getMillis();
+	}
+	if(!early && level == 0 && earlyMs >= 0) {
+		cancelled = true;
+	}
+}
+
+/**
+ * Run the cycles of one scenario, return false if its check fails
+ */
+static bool runScenario(const char* name, MQ131Model model, float valueR0, float threshold, float ratio) {
+	MQ131SensorModel sensor;
+	sensor.begin(ALARM_PIN_POWER, ALARM_PIN_SENSOR, model, ALARM_RL, valueR0, 1);
+	sensor.setEnv(20, 60);
+	sensor.setO3(threshold * ratio);
+	clockSource = &sensor;
+
+	MQ131Class driver(ALARM_RL);
+	driver.setHal(&sensor);
+	driver.begin(ALARM_PIN_POWER, ALARM_PIN_SENSOR, model, ALARM_RL);
+	driver.setR0(valueR0);
+	driver.setEnv(20, 60);
+
+	bool passed = true;
+	for(uint8_t cycle = 0; cycle < ALARM_CYCLES; cycle++) {
+		// New alarm at each cycle (an active alarm has no early warning)
+		MQ131AlarmClass alarm;
+		alarm.addLevel(threshold, 0.1 * threshold);
+		alarm.setCallback(onAlarm);
+		sensor.wait(ALARM_PAUSE_MS);
+		uint32_t startMs = sensor.getMillis();
+		earlyMs = -1;
+		cancelled = false;
+		uint8_t level = alarm.sample(driver);
+		uint32_t finalMs = sensor.getMillis();
+
+		bool ok;
+		if(ratio > 1) {
+			ok = earlyMs >= 0 && (uint32_t)earlyMs < finalMs && !cancelled && level == 1;
+		} else {
+			ok = earlyMs < 0 && level == 0;
+		}
+		if(earlyMs >= 0) {
+			printf("%s;%u;%.0f;%.0f;%.1f;%.0f;%.0f;%s;%s\n", name, cycle, threshold, threshold * ratio, driver.getO3(PPB),
+			       (finalMs - startMs) / 1000.0, (earlyMs - startMs) / 1000.0, cancelled ? "cancelled" : "confirmed",
+			       ok ? "ok" : "FAILED");
+		} else {
+			printf("%s;%u;%.0f;%.0f;%.1f;%.0f;-;-;%s\n", name, cycle, threshold, threshold * ratio, driver.getO3(PPB),
+			       (finalMs - startMs) / 1000.0, ok ? "ok" : "FAILED");
+		}
+		passed &= ok;
+	}
+	return passed;
+}
+
+int main() {
+	bool passed = true;
+	printf("model;cycle;threshold (ppb);ozone (ppb);final reading (ppb);final reading (s);early warning (s);early warning;check\n");
+	passed &= runScenario("LOW_CONCENTRATION", LOW_CONCENTRATION, 2000, 100, ALARM_ABOVE);
+	passed &= runScenario("LOW_CONCENTRATION", LOW_CONCENTRATION, 2000, 100, ALARM_BELOW);
+	passed &= runScenario("HIGH_CONCENTRATION", HIGH_CONCENTRATION, 2000, 10000, ALARM_ABOVE);
+	passed &= runScenario("HIGH_CONCENTRATION", HIGH_CONCENTRATION, 2000, 10000, ALARM_BELOW);
+	passed &= runScenario("SN_O2_LOW_CONCENTRATION", SN_O2_LOW_CONCENTRATION, 500000, 100, ALARM_ABOVE);
+	passed &= runScenario("SN_O2_LOW_CONCENTRATION", SN_O2_LOW_CONCENTRATION, 500000, 100, ALARM_BELOW);
+	return passed ? 0 : 1;
+}
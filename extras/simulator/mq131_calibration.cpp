@@ -0,0 +1,98 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Calibration of the driver on the simulated element (host only)             *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+// Run the calibration of the driver on MQ131SensorModel for several levels
+// of noise and thermal time constants, then one sample() with the result.
+// The R0 found is compared to Rs of the heated element in the calibration
+// gas (R0 of the model is Rs at the concentration a of the curve).
+// When Rs never stabilizes, the calibration stops at the timeout
+// (MQ131_DEFAULT_CALIBRATION_TIMEOUT, can be given at compilation), with R0
+// and the statistics from the tail of the calibration.
+//
+// Build (from this directory):
+//   g++ -O2 -std=c++11 -I. -I../../src ../../src/*.cpp MQ131SensorModel.cpp mq131_calibration.cpp -o mq131_calibration
+// Run (R0 of the element in Ohms, ozone in ppb during the calibration):
+//   ./mq131_calibration 2000 20
+
+#include <stdlib.h>
+
+#include "MQ131.h"
+#include "MQ131SensorModel.h"
+
+#define SIM_PIN_POWER                               2
+#define SIM_PIN_SENSOR                              14
+#define SIM_RL                                      10000             // Load resistance (keeps the ADC in range for R0 around 2 kOhms)
+
+int main(int argc, char** argv) {
+	float valueR0 = argc > 1 ? atof(argv[1]) : 2000;
+	float ppb = argc > 2 ? atof(argv[2]) : 20;
+
+	const float noises[] = {0.0, 0.001, 0.005, 0.02};
+	const float taus[] = {10.0, 20.0, 40.0};
+
+	printf("noise;tau (s);readings;timed out;R0 (Ohms);R0 error (%%);time to read (s);std dev (Ohms);slope (Ohms/s);O3 (ppb)\n");
+	for(uint8_t n = 0; n < sizeof(noises) / sizeof(noises[0]); n++) {
+		for(uint8_t t = 0; t < sizeof(taus) / sizeof(taus[0]); t++) {
+			MQ131SensorModel sensor;
+			sensor.begin(SIM_PIN_POWER, SIM_PIN_SENSOR, LOW_CONCENTRATION, SIM_RL, valueR0, 1);
+			sensor.setNoise(noises[n]);
+			sensor.setThermal(taus[t], MQ131_MODEL_ACTIVATION_EV);
+			sensor.setEnv(20, 60);
+			sensor.setO3(ppb);
+
+			MQ131Class driver(SIM_RL);
+			driver.setHal(&sensor);
+			driver.begin(SIM_PIN_POWER, SIM_PIN_SENSOR, LOW_CONCENTRATION, SIM_RL);
+			driver.setEnv(20, 60);
+
+			// Same loop as calibrate()
+			uint16_t readings = 1;
+			driver.startCalibration();
+			while(!driver.updateCalibration()) {
+				sensor.wait(1000);
+				readings++;
+			}
+
+			// Rs of the heated element in the calibration gas (expected R0)
+			float expectedR0 = sensor.getRs();
+
+			// Let the element cool down, then a normal cycle
+			sensor.wait(600000);
+			driver.sample();
+
+			MQ131CalibrationStats stats = driver.getCalibrationStats();
+			printf("%.3f;%.0f;%u;%s;%.0f;%.1f;%ld;%.1f;%.3f;%.1f\n", noises[n], taus[t], readings,
+			       stats.timedOut ? "yes" : "no", driver.getR0(),
+			       100.0 * (driver.getR0() / expectedR0 - 1.0), driver.getTimeToRead(),
+			       stats.stdDevRs, stats.slopeRs, driver.getO3(PPB));
+		}
+	}
+	return 0;
+}
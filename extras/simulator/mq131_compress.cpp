@@ -0,0 +1,238 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Benchmark and round trip of the compression of readings (host only)        *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+// Encode series of readings with MQ131CompressorClass, decode them with a
+// second instance and check the round trip:
+// - the timestamps are decoded exactly (including jumps and the wrap of
+//   the 32-bit clock)
+// - the concentrations within 0.05 ppb (quantization to 0.1 ppb), the
+//   values out of range saturated to MQ131_COMPRESS_MAX_PPB and NaN as 0
+// The series come from the driver on MQ131SensorModel (one week at one
+// reading per minute, daily cycle of ozone) with several levels of noise
+// and jitter of the sampling period, plus a series of edge values
+// (saturated readings, infinities, NaN). For each series, the size in
+// bytes per reading (16 in the log) and the time to encode and decode a
+// reading are printed (cycles of the time stamp counter on x86).
+// The exit code is 1 if a round trip fails.
+//
+// Build and run (from this directory):
+//   g++ -O2 -std=c++11 -I. -I../../src ../../src/*.cpp MQ131SensorModel.cpp mq131_compress.cpp -o mq131_compress
+//   ./mq131_compress
+
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "MQ131.h"
+#include "MQ131Compressor.h"
+#include "MQ131SensorModel.h"
+
+#define COMPRESS_PIN_POWER                          2
+#define COMPRESS_PIN_SENSOR                         14
+#define COMPRESS_RL                                 10000             // Load resistance (Ohms)
+#define COMPRESS_R0                                 2000              // R0 of the element (Ohms)
+#define COMPRESS_READINGS                           10080             // One week at one reading per minute
+#define COMPRESS_PERIOD_S                           60                // Sampling period (s)
+#define COMPRESS_PASSES                             200               // Passes over a series for the timings
+#define COMPRESS_MAX_ERROR                          0.05              // Half of the resolution (ppb)
+
+// Series of readings
+struct Series {
+	std::vector<uint32_t> timestamps;
+	std::vector<float> ppb;
+};
+
+/**
+ * Time stamp counter (0 when not available)
+ */
+static uint64_t getCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Readings of the driver on the model, with a daily cycle of ozone
+ */
+static Series makeSeries(float noise, uint8_t jitter) {
+	MQ131SensorModel sensor;
+	sensor.begin(COMPRESS_PIN_POWER, COMPRESS_PIN_SENSOR, LOW_CONCENTRATION, COMPRESS_RL, COMPRESS_R0, 1);
+	sensor.setNoise(noise);
+
+	MQ131Class driver(COMPRESS_RL);
+	driver.setHal(&sensor);
+	driver.begin(COMPRESS_PIN_POWER, COMPRESS_PIN_SENSOR, LOW_CONCENTRATION, COMPRESS_RL);
+	driver.setR0(COMPRESS_R0);
+
+	Series series;
+	uint32_t timestamp = 1700000000;
+	for(uint32_t reading = 0; reading < COMPRESS_READINGS; reading++) {
+		sensor.setO3(40 + 30 * sin(2 * M_PI * reading / (24 * 3600 / COMPRESS_PERIOD_S)));
+		sensor.wait(COMPRESS_PERIOD_S * 1000);
+		driver.sample();
+		timestamp += COMPRESS_PERIOD_S + (jitter > 0 ? rand() % (2 * jitter + 1) - jitter : 0);
+		series.timestamps.push_back(timestamp);
+		series.ppb.push_back(driver.getO3(PPB));
+	}
+	return series;
+}
+
+/**
+ * Values the encoder must bound, and jumps of the clock
+ */
+static Series makeEdgeSeries() {
+	const float values[] = {0.0, 0.04, 0.05, -3.0, 12.34, 1.0e7, 1.0e9, 3.0e38, INFINITY, -INFINITY, NAN, -1.0e9, 25.0};
+	const uint32_t timestamps[] = {0, 60, 120, 4000000000u, 5, 6, 0xFFFFFFFF, 0, 0x80000000, 0x7FFFFFFF, 100, 100, 160};
+	Series series;
+	for(uint8_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+		series.timestamps.push_back(timestamps[i]);
+		series.ppb.push_back(values[i]);
+	}
+	return series;
+}
+
+/**
+ * Value expected after the round trip (before the quantization)
+ */
+static float getExpected(float ppb) {
+	if(isnan(ppb)) {
+		return 0;
+	}
+	return ppb > MQ131_COMPRESS_MAX_PPB ? MQ131_COMPRESS_MAX_PPB
+	     : ppb < -MQ131_COMPRESS_MAX_PPB ? -MQ131_COMPRESS_MAX_PPB : ppb;
+}
+
+/**
+ * Bytes of the stream given to the decoder (its size is on 8 bits)
+ */
+static uint8_t getAvailable(const std::vector<uint8_t>& stream, size_t position) {
+	size_t available = stream.size() - position;
+	return available < MQ131_COMPRESS_MAX_BYTES ? available : MQ131_COMPRESS_MAX_BYTES;
+}
+
+/**
+ * Encode the series in a stream
+ */
+static bool encodeSeries(const Series& series, std::vector<uint8_t>& stream) {
+	MQ131CompressorClass encoder;
+	uint8_t data[MQ131_COMPRESS_MAX_BYTES];
+	stream.clear();
+	for(size_t i = 0; i < series.ppb.size(); i++) {
+		uint8_t length = encoder.encode(series.timestamps[i], series.ppb[i], data, sizeof(data));
+		if(length == 0) {
+			return false;
+		}
+		stream.insert(stream.end(), data, data + length);
+	}
+	return true;
+}
+
+/**
+ * Run one series, return false if its round trip fails
+ */
+static bool runSeries(const char* name, const Series& series) {
+	std::vector<uint8_t> stream;
+	bool passed = encodeSeries(series, stream);
+
+	// Round trip
+	MQ131CompressorClass decoder;
+	size_t position = 0;
+	uint32_t wrongTimestamps = 0;
+	float maxError = 0;
+	for(size_t i = 0; i < series.ppb.size() && passed; i++) {
+		uint32_t timestamp;
+		float ppb;
+		uint8_t length = decoder.decode(&stream[position], getAvailable(stream, position), timestamp, ppb);
+		if(length == 0) {
+			passed = false;
+			break;
+		}
+		position += length;
+		float expected = getExpected(series.ppb[i]);
+		float error = fabs(ppb - expected);
+		if(error > maxError) {
+			maxError = error;
+		}
+		wrongTimestamps += timestamp != series.timestamps[i] ? 1 : 0;
+		// Float resolution of the large values on top of the quantization
+		passed &= error <= COMPRESS_MAX_ERROR + 1.0e-6 * fabs(expected);
+	}
+	passed &= position == stream.size() && wrongTimestamps == 0;
+
+	// Timings: several passes over the series (the buffer stays in cache)
+	uint8_t data[MQ131_COMPRESS_MAX_BYTES];
+	uint32_t checksum = 0;
+	uint64_t readings = (uint64_t)COMPRESS_PASSES * series.ppb.size();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	uint64_t startCycles = getCycles();
+	for(uint16_t pass = 0; pass < COMPRESS_PASSES; pass++) {
+		MQ131CompressorClass encoder;
+		for(size_t i = 0; i < series.ppb.size(); i++) {
+			checksum += encoder.encode(series.timestamps[i], series.ppb[i], data, sizeof(data));
+		}
+	}
+	uint64_t encodeCycles = getCycles() - startCycles;
+	double encodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	for(uint16_t pass = 0; pass < COMPRESS_PASSES; pass++) {
+		MQ131CompressorClass decoder;
+		uint32_t timestamp;
+		float ppb;
+		for(position = 0; position < stream.size(); ) {
+			// Checked above, every reading is decoded
+			position += decoder.decode(&stream[position], getAvailable(stream, position), timestamp, ppb);
+		}
+		checksum += timestamp;
+	}
+	double decodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%s;%u;%.2f;%.1f;%.0f;%.1f;%.3f;%u;%s\n", name, (uint32_t)series.ppb.size(),
+	       (double)stream.size() / series.ppb.size(), encodeNs / readings, (double)encodeCycles / readings,
+	       decodeNs / readings, maxError, wrongTimestamps, passed ? "ok" : "FAILED");
+	// Keep the timed loops
+	return passed || checksum == 0;
+}
+
+int main() {
+	bool passed = true;
+	srand(1);
+	printf("series;readings;bytes per reading;encode (ns);encode (cycles);decode (ns);max error (ppb);wrong timestamps;check\n");
+	passed &= runSeries("regular, noise 0.5%", makeSeries(0.005, 0));
+	passed &= runSeries("regular, noise 2%", makeSeries(0.02, 0));
+	passed &= runSeries("jitter 2 s, noise 0.5%", makeSeries(0.005, 2));
+	passed &= runSeries("edge values", makeEdgeSeries());
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Test vectors of the mass concentration conversion (host only)              *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+// Check convert() against test vectors of the ideal gas law: ug/m3 for one
+// ppb of O3 (M = 48 g/mol, R = 83.14462618 hPa.L/(mol.K)), computed in
+// double precision on the host for sea level, hot, cold and high-altitude
+// sites. For each vector, the environment is given once with setEnv() and
+// once through a barometer (pressure read at sample()):
+// - ppb to ug/m3 and ppm to mg/m3 (same factor)
+// - ppm to ug/m3 and ppb to mg/m3 (factor scaled by 1000)
+// - ppm to ppb (independent of the environment)
+// (the inputs of convert() are the units of the sensors: ppb or ppm)
+// The exit code is 1 if a conversion deviates more than CONVERT_TOLERANCE.
+//
+// Build and run (from this directory):
+//   g++ -O2 -std=c++11 -I. -I../../src ../../src/*.cpp mq131_convert.cpp -o mq131_convert
+//   ./mq131_convert
+
+#include <stdlib.h>
+
+#include "MQ131.h"
+
+#define CONVERT_PIN_POWER                           2
+#define CONVERT_PIN_SENSOR                          14
+#define CONVERT_RL                                  10000             // Load resistance (Ohms)
+#define CONVERT_TOLERANCE                           1.0e-5            // Max relative deviation (float precision)
+
+// Test vector: ug/m3 for one ppb at the temperature and the pressure
+struct ConvertVector {
+	int8_t temperature;
+	uint16_t pressure;
+	double factor;
+};
+
+static const ConvertVector vectors[] = {
+	{25, 1013, 1.96147},
+	{0, 1013, 2.14099},
+	{20, 1013, 1.99493},
+	{45, 1013, 1.83817},
+	{-20, 1030, 2.34891},
+	{20, 900, 1.77239},
+	{5, 701, 1.45494},
+	{35, 795, 1.4894},
+	{50, 600, 1.0719},
+};
+
+/**
+ * Circuit giving half of the scale, with a clock that doesn't wait
+ */
+class FixedCircuit : public MQ131Hal {
+	public:
+		void setPinMode(uint8_t, uint8_t) {}
+		void writePin(uint8_t, uint8_t) {}
+		uint16_t readAnalog(uint8_t) { return MQ131_ADC_STEPS / 2; }
+		uint32_t getMillis() { return clockMs; }
+		void wait(uint32_t ms) { clockMs += ms; }
+
+	private:
+		uint32_t clockMs = 0;
+};
+
+/**
+ * Barometer giving a fixed pressure
+ */
+class FixedBarometer : public MQ131Barometer {
+	public:
+		FixedBarometer(uint16_t _pressure) : pressure(_pressure) {}
+
+		uint16_t getPressureHPa() { return pressure; }
+
+	private:
+		uint16_t pressure;
+};
+
+/**
+ * Relative deviation of a conversion (printed)
+ */
+static double check(double value, double expected) {
+	double deviation = value / expected - 1.0;
+	printf(";%.5f", value);
+	return fabs(deviation);
+}
+
+int main() {
+	double maxDeviation = 0;
+	printf("source;temperature;pressure (hPa);expected (ug/m3 per ppb);ppb to ug/m3;ppm to mg/m3;ppm to ug/m3 (/1000);ppb to mg/m3 (x1000);ppm to ppb (/1000)\n");
+	for(uint8_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+		const ConvertVector& vector = vectors[i];
+		for(uint8_t fromBarometer = 0; fromBarometer < 2; fromBarometer++) {
+			FixedCircuit circuit;
+			FixedBarometer barometer(vector.pressure);
+			MQ131Class driver(CONVERT_RL);
+			driver.setHal(&circuit);
+			driver.begin(CONVERT_PIN_POWER, CONVERT_PIN_SENSOR, LOW_CONCENTRATION, CONVERT_RL);
+			if(fromBarometer) {
+				driver.setEnv(vector.temperature, 60);
+				driver.setBarometer(&barometer);
+				driver.setTimeToRead(0);
+				driver.sample();
+			} else {
+				driver.setEnv(vector.temperature, 60, vector.pressure);
+			}
+			printf("%s;%d;%u;%.5f", fromBarometer ? "barometer" : "setEnv", vector.temperature, vector.pressure,
+			       vector.factor);
+			double deviations[] = {
+				check(driver.convert(1.0, PPB, UG_M3), vector.factor),
+				check(driver.convert(1.0, PPM, MG_M3), vector.factor),
+				check(driver.convert(1.0, PPM, UG_M3) / 1000.0, vector.factor),
+				check(driver.convert(1.0, PPB, MG_M3) * 1000.0, vector.factor),
+				check(driver.convert(1.0, PPM, PPB) / 1000.0, 1.0),
+			};
+			printf("\n");
+			for(uint8_t d = 0; d < sizeof(deviations) / sizeof(deviations[0]); d++) {
+				if(!(deviations[d] <= maxDeviation)) {
+					maxDeviation = deviations[d];
+				}
+			}
+		}
+	}
+	printf("max deviation;%.2e;tolerance;%.0e\n", maxDeviation, CONVERT_TOLERANCE);
+	return maxDeviation <= CONVERT_TOLERANCE ? 0 : 1;
+}
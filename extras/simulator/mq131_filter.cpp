@@ -0,0 +1,176 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Check of the Hampel filter on synthetic spike traces (host only)           *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+// Run the driver with the Hampel filter on traces of MQ131SensorModel (noise
+// of about one ADC step, slow drift of R0, quantization of the ADC) and
+// inject spikes in the ADC codes:
+// - clean: no spike, no reading may be rejected (the window is often
+//   constant, a change of one code is not an outlier)
+// - spikes: one reading in 13 is a spike (code divided by 4, or 0), each one
+//   must be rejected and replaced by a value close to the true Rs
+// - step: the ozone jumps from 20 to 120 ppb, the filter must follow the
+//   new level after half of the window
+// The number of rejected readings and the error on Rs are printed for each
+// trace; the exit code is 1 if one of the checks fails.
+//
+// Build and run (from this directory):
+//   g++ -O2 -std=c++11 -I. -I../../src ../../src/*.cpp MQ131SensorModel.cpp mq131_filter.cpp -o mq131_filter
+//   ./mq131_filter
+
+#include <stdlib.h>
+
+#include "MQ131.h"
+#include "MQ131SensorModel.h"
+
+#define FILTER_PIN_POWER                            2
+#define FILTER_PIN_SENSOR                           14
+#define FILTER_RL                                   10000             // Load resistance (Ohms)
+#define FILTER_R0                                   2000              // R0 of the element (Ohms)
+#define FILTER_WINDOW                               7                 // Readings in the window of the filter
+#define FILTER_READINGS                             500               // Readings of each trace
+#define FILTER_PERIOD_MS                            60000             // Time between two readings
+#define FILTER_SPIKE_PERIOD                         13                // One spike every n readings
+#define FILTER_NOISE                                0.004             // Relative noise on Rs (about one ADC step)
+#define FILTER_DRIFT                                0.05              // Drift of R0 per day (a few codes over the trace)
+#define FILTER_MAX_RS_ERROR                         0.05              // Max error on Rs after a rejected spike
+
+/**
+ * Element of the model with spikes on the ADC codes (interference on the
+ * sensor lead)
+ */
+class SpikyCircuit : public MQ131Hal {
+	public:
+		SpikyCircuit(MQ131SensorModel* _sensor) : sensor(_sensor) {}
+
+		void setPinMode(uint8_t pin, uint8_t mode) { sensor->setPinMode(pin, mode); }
+		void writePin(uint8_t pin, uint8_t value) { sensor->writePin(pin, value); }
+		uint32_t getMillis() { return sensor->getMillis(); }
+		void wait(uint32_t ms) { sensor->wait(ms); }
+
+		uint16_t readAnalog(uint8_t pin) {
+			uint16_t code = sensor->readAnalog(pin);
+			if(!spike) {
+				return code;
+			}
+			spikes++;
+			return spikes % 2 ? code / 4 : 0;
+		}
+
+		bool spike = false;
+		uint16_t spikes = 0;
+
+	private:
+		MQ131SensorModel* sensor;
+};
+
+/**
+ * Debug stream of the driver, counts the rejected readings
+ */
+class RejectCounter : public Stream {
+	public:
+		size_t write(uint8_t) { return 1; }
+		size_t write(const uint8_t* buffer, size_t size) {
+			if(size >= 23 && memcmp(buffer, "MQ131 : Outlier rejected", 23) == 0) {
+				rejected++;
+			}
+			return size;
+		}
+
+		uint16_t rejected = 0;
+};
+
+/**
+ * Run one trace, return false if its check fails
+ */
+static bool runTrace(const char* name, bool spikes, float ppbAfter) {
+	MQ131SensorModel sensor;
+	sensor.begin(FILTER_PIN_POWER, FILTER_PIN_SENSOR, LOW_CONCENTRATION, FILTER_RL, FILTER_R0, 1);
+	sensor.setNoise(FILTER_NOISE);
+	sensor.setDrift(FILTER_DRIFT);
+	// Element hot as soon as the heater is on (the trace is about the noise)
+	sensor.setThermal(0.001, MQ131_MODEL_ACTIVATION_EV);
+	sensor.setO3(20);
+
+	SpikyCircuit circuit(&sensor);
+	RejectCounter counter;
+	float window[FILTER_WINDOW];
+	MQ131Class driver(FILTER_RL);
+	driver.setHal(&circuit);
+	driver.begin(FILTER_PIN_POWER, FILTER_PIN_SENSOR, LOW_CONCENTRATION, FILTER_RL, &counter);
+	driver.setTimeToRead(0);
+	driver.enableFilter(window, FILTER_WINDOW);
+
+	uint16_t missed = 0;
+	uint16_t lateReadings = 0;
+	float maxError = 0;
+	uint16_t stepReading = FILTER_READINGS / 2;
+	for(uint16_t reading = 0; reading < FILTER_READINGS; reading++) {
+		if(reading == stepReading) {
+			sensor.setO3(ppbAfter);
+		}
+		sensor.wait(FILTER_PERIOD_MS);
+		circuit.spike = spikes && reading >= FILTER_WINDOW && reading % FILTER_SPIKE_PERIOD == 0;
+		uint16_t rejectedBefore = counter.rejected;
+		driver.sample();
+
+		float error = fabs(driver.getRs() / sensor.getRs() - 1.0);
+		if(circuit.spike) {
+			if(counter.rejected == rejectedBefore) {
+				missed++;
+			}
+			if(error > maxError) {
+				maxError = error;
+			}
+		} else if(reading > stepReading + FILTER_WINDOW / 2 && error > FILTER_MAX_RS_ERROR) {
+			// Real change still rejected after half of the window
+			lateReadings++;
+		}
+	}
+
+	// Without step, only the spikes may be rejected (the first readings
+	// after a step are rejected until the median follows)
+	bool passed = missed == 0 && maxError <= FILTER_MAX_RS_ERROR && lateReadings == 0;
+	if(ppbAfter == 20) {
+		passed &= counter.rejected == circuit.spikes;
+	}
+	printf("%s;%u;%u;%u;%.2f;%u;%s\n", name, circuit.spikes, counter.rejected, missed, 100.0 * maxError,
+	       lateReadings, passed ? "ok" : "FAILED");
+	return passed;
+}
+
+int main() {
+	bool passed = true;
+	printf("trace;spikes;rejected;missed spikes;max Rs error on spikes (%%);late readings after the step;check\n");
+	passed &= runTrace("clean", false, 20);
+	passed &= runTrace("spikes", true, 20);
+	passed &= runTrace("step", false, 120);
+	passed &= runTrace("step with spikes", true, 120);
+	return passed ? 0 : 1;
+}
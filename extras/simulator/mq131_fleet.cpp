@@ -0,0 +1,230 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Fleet simulator: many MQ131 sensors on virtual clocks (host only)          *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+// Each simulated sensor runs the real driver (MQ131Class) with its own
+// virtual clock and pins (MQ131Hal): sample() doesn't wait, it moves the
+// clock of the sensor forward. The element is simulated by MQ131SensorModel
+// (heater transient, gas response, environment, noise and drift) under a
+// daily cycle of ozone and temperature. The readings are sent in binary
+// frames (MQ131FrameClass) on the standard output, as the gateway receives
+// them (see extras/gateway/mq131_ingest.py).
+//
+// The sensors are shared between the threads; each thread runs the cycles
+// of its sensors period by period. The frames of one sensor only depend on
+// its identifier (same output for any number of threads), only the order
+// of the frames of different sensors changes.
+//
+// Build (from this directory):
+//   g++ -O2 -std=c++11 -pthread -I. -I../../src ../../src/*.cpp MQ131SensorModel.cpp mq131_fleet.cpp -o mq131_fleet
+// Run (sensors, threads, hours, sampling period in seconds, acceleration):
+//   ./mq131_fleet 5000 8 24 300 0 > frames.bin
+// Acceleration 0 runs as fast as possible, otherwise the periods are paced
+// on the wall clock (e.g. 60 = one virtual minute per second)
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+
+#include "MQ131.h"
+#include "MQ131Frame.h"
+#include "MQ131SensorModel.h"
+
+#define SIM_PIN_POWER                               2
+#define SIM_PIN_SENSOR                              14
+#define SIM_RL                                      10000             // Load resistance (keeps the ADC in range for R0 around 2 kOhms)
+#define SIM_START_TIMESTAMP                         1700000000        // Timestamp of the first period (s)
+
+/**
+ * Scenario of one node: daily cycles of ozone and temperature
+ * (same parameters for the same identifier)
+ */
+class Scenario {
+	public:
+		void begin(uint16_t id) {
+			random = 2463534242UL + id * 2654435761UL;
+			valueR0 = MQ131_DEFAULT_LO_CONCENTRATION_R0 * (0.8 + 0.4 * nextUniform());
+			driftPerDay = 0.002 * nextUniform();
+			baseline = 20.0 + 20.0 * nextUniform();
+			amplitude = baseline * (0.3 + 0.6 * nextUniform());
+			phase = 2.0 * M_PI * nextUniform();
+			temperature = 10.0 + 15.0 * nextUniform();
+			humidity = 40.0 + 40.0 * nextUniform();
+		}
+
+		// Ozone (ppb) at the given time (ms)
+		float getO3(uint32_t ms) {
+			float ppb = baseline + amplitude * sin(getAngle(ms));
+			return ppb > 1.0 ? ppb : 1.0;
+		}
+
+		// Temperature (Celsius, warmer in the afternoon like ozone)
+		float getTemperature(uint32_t ms) {
+			return temperature + 5.0 * sin(getAngle(ms));
+		}
+
+		// Humidity (%, lower in the afternoon)
+		float getHumidity(uint32_t ms) {
+			return humidity - 10.0 * sin(getAngle(ms));
+		}
+
+		float valueR0 = 0;
+		float driftPerDay = 0;
+
+	private:
+		float getAngle(uint32_t ms) {
+			return 2.0 * M_PI * ms / 86400000.0 + phase;
+		}
+
+		// Uniform in [0, 1[ (xorshift)
+		float nextUniform() {
+			random ^= random << 13;
+			random ^= random >> 17;
+			random ^= random << 5;
+			return (random & 0xFFFFFF) / 16777216.0;
+		}
+
+		uint32_t random = 0;
+		float baseline = 0;
+		float amplitude = 0;
+		float phase = 0;
+		float temperature = 0;
+		float humidity = 0;
+};
+
+/**
+ * Frames of one thread, written on the standard output period by period
+ */
+class FrameBuffer : public Stream {
+	public:
+		size_t write(uint8_t value) {
+			data.push_back(value);
+			return 1;
+		}
+
+		size_t write(const uint8_t* buffer, size_t size) {
+			data.insert(data.end(), buffer, buffer + size);
+			return size;
+		}
+
+		void flush(std::mutex& lock) {
+			std::lock_guard<std::mutex> guard(lock);
+			fwrite(data.data(), 1, data.size(), stdout);
+			data.clear();
+		}
+
+	private:
+		std::vector<uint8_t> data;
+};
+
+/**
+ * One node of the fleet (sensor, driver and frames)
+ */
+struct Node {
+	Node() : driver(SIM_RL) {}
+
+	Scenario scenario;
+	MQ131SensorModel sensor;
+	MQ131Class driver;
+	MQ131FrameClass frame;
+};
+
+int main(int argc, char** argv) {
+	uint32_t sensors = argc > 1 ? atol(argv[1]) : 1000;
+	uint32_t threads = argc > 2 ? atol(argv[2]) : std::thread::hardware_concurrency();
+	float hours = argc > 3 ? atof(argv[3]) : 24;
+	uint32_t period = argc > 4 ? atol(argv[4]) : 300;
+	float acceleration = argc > 5 ? atof(argv[5]) : 0;
+	if(sensors < 1 || sensors > 65535 || threads < 1 || period < MQ131_DEFAULT_LO_CONCENTRATION_TIME2READ) {
+		fprintf(stderr, "Usage: %s <sensors (1-65535)> <threads> <hours> <period (s, >= %d)> [acceleration]\n",
+		        argv[0], MQ131_DEFAULT_LO_CONCENTRATION_TIME2READ);
+		return 1;
+	}
+	// Virtual clocks in milliseconds on 32 bits (as millis())
+	uint32_t periods = hours * 3600 / period;
+	if((uint64_t)(periods + 1) * period * 1000 > 0xFFFFFFFFULL) {
+		fprintf(stderr, "Simulated time limited to %lu hours\n", 0xFFFFFFFFUL / 3600000UL);
+		return 1;
+	}
+
+	std::vector<Node> nodes(sensors);
+	std::vector<FrameBuffer> buffers(threads);
+	for(uint32_t i = 0; i < sensors; i++) {
+		Node& node = nodes[i];
+		node.scenario.begin(i);
+		node.sensor.begin(SIM_PIN_POWER, SIM_PIN_SENSOR, LOW_CONCENTRATION, SIM_RL, node.scenario.valueR0, i + 1);
+		node.sensor.setDrift(node.scenario.driftPerDay);
+		node.driver.setHal(&node.sensor);
+		node.driver.begin(SIM_PIN_POWER, SIM_PIN_SENSOR, LOW_CONCENTRATION, SIM_RL);
+		// Calibrated at the installation
+		node.driver.setR0(node.scenario.valueR0);
+		node.frame.begin(&buffers[i % threads], i);
+	}
+
+	std::mutex outputLock;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for(uint32_t t = 0; t < threads; t++) {
+		workers.push_back(std::thread([&, t]() {
+			for(uint32_t p = 0; p < periods; p++) {
+				for(uint32_t i = t; i < sensors; i += threads) {
+					Node& node = nodes[i];
+					uint32_t ms = p * period * 1000;
+					node.sensor.waitUntil(ms);
+					// The node measures the environment (with its own resolution)
+					float temperature = node.scenario.getTemperature(ms);
+					float humidity = node.scenario.getHumidity(ms);
+					node.sensor.setO3(node.scenario.getO3(ms));
+					node.sensor.setEnv(temperature, humidity);
+					node.driver.setEnv(lround(temperature), lround(humidity));
+					node.driver.sample();
+					node.frame.write(node.driver, SIM_START_TIMESTAMP + node.sensor.getMillis() / 1000);
+				}
+				buffers[t].flush(outputLock);
+				if(acceleration > 0) {
+					std::this_thread::sleep_until(start + std::chrono::microseconds(
+						(uint64_t)((p + 1) * period * 1e6 / acceleration)));
+				}
+			}
+		}));
+	}
+	for(uint32_t t = 0; t < threads; t++) {
+		workers[t].join();
+	}
+	fflush(stdout);
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	uint64_t readings = (uint64_t)sensors * periods;
+	fprintf(stderr, "%u sensors, %u threads, %llu readings in %.2f s: %.0f readings/s, %.0fx real time\n",
+	        sensors, threads, (unsigned long long)readings, elapsed, readings / elapsed,
+	        periods * period / elapsed);
+	return 0;
+}
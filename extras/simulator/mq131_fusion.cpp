@@ -0,0 +1,121 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Sweep of the range selection of the fusion of two sensors (host only)      *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+// Sweep the readings of both sensors across the overlap of the ranges
+// (MQ131_FUSION_LOW_MAX_PPB to MQ131_FUSION_HIGH_MIN_PPB) and check that
+// the output of MQ131FusionClass::fuse() is continuous:
+// - paths where both sensors read the true concentration with a bias
+//   (the high sensor reading 0.2 to 5 times the low one)
+// - paths where one reading is fixed and the other one sweeps from
+//   FUSION_MAX_BIAS times below to FUSION_MAX_BIAS times above it
+// Each step moves a reading by FUSION_STEP; the output may not move by more
+// than FUSION_MAX_JUMP (relative). The output is also checked at the ends:
+// the low sensor alone below the overlap, the high sensor alone above.
+// The worst jump of each path is printed; the exit code is 1 if a check
+// fails.
+//
+// Build and run (from this directory):
+//   g++ -O2 -std=c++11 -I. -I../../src ../../src/*.cpp mq131_fusion.cpp -o mq131_fusion
+//   ./mq131_fusion
+
+#include <stdlib.h>
+
+#include "MQ131Fusion.h"
+
+#define FUSION_MIN_PPB                              100               // Start of the sweep
+#define FUSION_MAX_PPB                              100000            // End of the sweep
+#define FUSION_STEP                                 1.001             // Ratio between two steps of a reading
+#define FUSION_MAX_JUMP                             0.01              // Max relative change of the output for one step
+#define FUSION_MAX_BIAS                             5.0               // Max ratio between the readings of both sensors
+
+/**
+ * Sweep one path, return the worst relative jump of the output
+ * (reading of each sensor: fixed value, or the concentration times a bias
+ * when the fixed value is 0)
+ */
+static float sweep(MQ131FusionClass& fusion, float lowFixed, float lowBias, float highFixed, float highBias,
+                   bool& endsOk) {
+	float worstJump = 0;
+	float previous = -1;
+	// Around the fixed reading (sensors within FUSION_MAX_BIAS)
+	float fixed = lowFixed > 0 ? lowFixed : highFixed;
+	float start = fixed > 0 ? fixed / FUSION_MAX_BIAS : FUSION_MIN_PPB;
+	float end = fixed > 0 ? fixed * FUSION_MAX_BIAS : FUSION_MAX_PPB;
+	for(float ppb = start; ppb <= end; ppb *= FUSION_STEP) {
+		float low = lowFixed > 0 ? lowFixed : ppb * lowBias;
+		float high = highFixed > 0 ? highFixed : ppb * highBias;
+		float value = fusion.fuse(low, high);
+		if(previous > 0) {
+			float jump = fabs(value / previous - 1.0);
+			if(jump > worstJump) {
+				worstJump = jump;
+			}
+		}
+		previous = value;
+		// Both readings on the same side of the overlap: one sensor alone
+		float mean = sqrt(low * high);
+		if(mean <= MQ131_FUSION_LOW_MAX_PPB && value != low) {
+			endsOk = false;
+		}
+		if(mean >= MQ131_FUSION_HIGH_MIN_PPB && value != high) {
+			endsOk = false;
+		}
+	}
+	return worstJump;
+}
+
+int main() {
+	MQ131FusionClass fusion(1000000, 1000000);
+	const float biases[] = {1.0 / FUSION_MAX_BIAS, 0.5, 1.0, 2.0, FUSION_MAX_BIAS};
+	const float fixedValues[] = {999, 1000, 3000, 9999, 10000};
+	bool passed = true;
+
+	printf("low sensor;high sensor;worst jump (%%);ends;check\n");
+	for(uint8_t b = 0; b < sizeof(biases) / sizeof(biases[0]); b++) {
+		bool endsOk = true;
+		float jump = sweep(fusion, 0, 1.0, 0, biases[b], endsOk);
+		bool ok = jump <= FUSION_MAX_JUMP && endsOk;
+		printf("sweep;sweep x %g;%.3f;%s;%s\n", biases[b], 100.0 * jump, endsOk ? "ok" : "WRONG", ok ? "ok" : "FAILED");
+		passed &= ok;
+	}
+	for(uint8_t f = 0; f < sizeof(fixedValues) / sizeof(fixedValues[0]); f++) {
+		bool endsOk = true;
+		float jump = sweep(fusion, fixedValues[f], 1.0, 0, 1.0, endsOk);
+		bool ok = jump <= FUSION_MAX_JUMP && endsOk;
+		printf("%g;sweep;%.3f;%s;%s\n", fixedValues[f], 100.0 * jump, endsOk ? "ok" : "WRONG", ok ? "ok" : "FAILED");
+		passed &= ok;
+		endsOk = true;
+		jump = sweep(fusion, 0, 1.0, fixedValues[f], 1.0, endsOk);
+		ok = jump <= FUSION_MAX_JUMP && endsOk;
+		printf("sweep;%g;%.3f;%s;%s\n", fixedValues[f], 100.0 * jump, endsOk ? "ok" : "WRONG", ok ? "ok" : "FAILED");
+		passed &= ok;
+	}
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,292 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Property checks of the conversion and calibration paths (host only)        *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+// Drive the driver with arbitrary settings, ADC codes and timings, and
+// check after each step:
+// - every concentration is finite and positive (no NaN, no infinity),
+//   including the saturated ADC codes (0 and the last code), with or
+//   without the lookup table and the Hampel filter
+// - R0 stays finite and positive whatever is given to setR0()
+// - the response is monotonic over all the ADC codes (the concentration
+//   falls with the code when b > 0, rises when b < 0)
+// - the calibration terminates within MQ131_DEFAULT_CALIBRATION_TIMEOUT
+//   readings, even with noise and the counters above 255
+// - sample() terminates, even when millis() wraps during the heating
+// Each input is a sequence of bytes decoded into operations. Without
+// libFuzzer, the bytes come from a random generator without end (one run
+// per seed, the failing seed is printed); with libFuzzer, the input is
+// given by the fuzzer (zeros after its end).
+//
+// Build and run (from this directory), abort() at the first failure:
+//   g++ -O1 -g -std=c++11 -fsanitize=address,undefined -I. -I../../src ../../src/*.cpp mq131_fuzz.cpp -o mq131_fuzz
+//   ./mq131_fuzz 10000
+// With libFuzzer (clang):
+//   clang++ -O1 -g -std=c++11 -fsanitize=fuzzer,address,undefined -DMQ131_LIBFUZZER -I. -I../../src ../../src/*.cpp mq131_fuzz.cpp -o mq131_fuzz
+//   ./mq131_fuzz -max_total_time=600
+
+#include <stdlib.h>
+
+#include "MQ131.h"
+
+#define FUZZ_PIN_POWER                              2
+#define FUZZ_PIN_SENSOR                             14
+#define FUZZ_MAX_OPERATIONS                         64                // Operations decoded from one input
+#define FUZZ_MONOTONIC_TOLERANCE                    1.0e-3            // Relative slack of the polynomial math options
+
+/**
+ * Bytes of the input (zeros after the end), or random bytes (xorshift)
+ * when there is no input
+ */
+class FuzzInput {
+	public:
+		FuzzInput(const uint8_t* _data, size_t _size, uint32_t seed) : data(_data), size(_size), random(seed | 1) {}
+
+		uint8_t next8() {
+			if(data == NULL) {
+				random ^= random << 13;
+				random ^= random >> 17;
+				random ^= random << 5;
+				return random >> 24;
+			}
+			return position < size ? data[position++] : 0;
+		}
+
+		uint16_t next16() {
+			return next8() | (uint16_t)next8() << 8;
+		}
+
+		uint32_t next32() {
+			return next16() | (uint32_t)next16() << 16;
+		}
+
+		bool isEmpty() {
+			return data != NULL && position >= size;
+		}
+
+		// Float with the special values a user could give by mistake
+		float nextFloat() {
+			switch(next8() % 8) {
+				case 0 : return 0.0;
+				case 1 : return -next16();
+				case 2 : return NAN;
+				case 3 : return INFINITY;
+				case 4 : return ldexp(1.0 + next8() / 256.0, (int8_t)next8());
+				default : return 1.0 + next16();
+			}
+		}
+
+	private:
+		const uint8_t* data;
+		size_t size;
+		size_t position = 0;
+		uint32_t random;
+};
+
+/**
+ * Circuit giving arbitrary ADC codes (biased to the saturated codes), with
+ * a clock starting anywhere (wrap of millis()) and jitter on each wait
+ */
+class FuzzCircuit : public MQ131Hal {
+	public:
+		FuzzCircuit(FuzzInput* _input) : input(_input) {
+			clockMs = input->next32();
+		}
+
+		void setPinMode(uint8_t, uint8_t) {}
+		void writePin(uint8_t, uint8_t) {}
+		uint32_t getMillis() { return clockMs; }
+		void wait(uint32_t ms) { clockMs += ms + input->next8() % 16; }
+
+		uint16_t readAnalog(uint8_t) {
+			if(fixedCode >= 0) {
+				return fixedCode;
+			}
+			switch(input->next8() % 4) {
+				case 0 : return 0;
+				case 1 : return MQ131_ADC_STEPS - 1;
+				default : return input->next16() % MQ131_ADC_STEPS;
+			}
+		}
+
+		// Code given to every reading (-1 for arbitrary codes)
+		int32_t fixedCode = -1;
+
+	private:
+		FuzzInput* input;
+		uint32_t clockMs;
+};
+
+// Seed of the random run (0 with libFuzzer)
+static uint32_t fuzzSeed = 0;
+
+/**
+ * Stop at the first failure (abort() for libFuzzer and the sanitizers)
+ */
+static void check(bool condition, const char* property, float value) {
+	if(!condition) {
+		fprintf(stderr, "Property failed: %s (value %g, seed %u)\n", property, value, fuzzSeed);
+		abort();
+	}
+}
+
+/**
+ * Every unit of the last reading is finite and positive
+ */
+static void checkReading(MQ131Class& driver) {
+	check(isfinite(driver.getR0()) && driver.getR0() > 0, "R0 finite and positive", driver.getR0());
+	for(uint8_t unit = PPM; unit <= UG_M3; unit++) {
+		float value = driver.getO3((MQ131Unit)unit);
+		check(isfinite(value) && value >= 0, "concentration finite and positive", value);
+	}
+}
+
+/**
+ * Sweep all the ADC codes with the current settings (without filter)
+ */
+static void checkMonotonic(MQ131Class& driver, FuzzCircuit& circuit) {
+	// The filter would replace the end of the sweep by the median
+	driver.disableFilter();
+	float direction = driver.getCurveB() > 0 ? 1.0 : -1.0;
+	float previous = 0;
+	for(int32_t code = MQ131_ADC_STEPS - 1; code >= 0; code--) {
+		circuit.fixedCode = code;
+		driver.sample();
+		checkReading(driver);
+		float value = driver.getO3(PPB);
+		// Rs rises when the code falls
+		if(code < MQ131_ADC_STEPS - 1) {
+			check(direction * (value - previous) >= -FUZZ_MONOTONIC_TOLERANCE * fabs(previous),
+			      "response monotonic with the ADC code", code);
+		}
+		previous = value;
+	}
+	circuit.fixedCode = -1;
+}
+
+/**
+ * Calibration with the arbitrary codes, bounded by the timeout
+ */
+static void checkCalibration(MQ131Class& driver) {
+	uint32_t readings = 1;
+	driver.startCalibration();
+	while(!driver.updateCalibration()) {
+		check(readings <= MQ131_DEFAULT_CALIBRATION_TIMEOUT, "calibration terminates", readings);
+		driver.getHal()->wait(1000);
+		readings++;
+	}
+	MQ131CalibrationStats stats = driver.getCalibrationStats();
+	check(stats.samples == readings, "calibration counts every reading", stats.samples);
+	check(isfinite(driver.getR0()) && driver.getR0() > 0, "calibrated R0 finite and positive", driver.getR0());
+}
+
+/**
+ * Run the operations of one input
+ */
+static int runInput(FuzzInput& input) {
+	static uint16_t table[MQ131_ADC_STEPS];
+	static float window[MQ131_FILTER_MAX_WINDOW];
+	const MQ131Model models[] = {LOW_CONCENTRATION, HIGH_CONCENTRATION, SN_O2_LOW_CONCENTRATION};
+
+	FuzzCircuit circuit(&input);
+	uint32_t RL = 1 + input.next32() % 10000000;
+	MQ131Class driver(RL);
+	driver.setHal(&circuit);
+	driver.begin(FUZZ_PIN_POWER, FUZZ_PIN_SENSOR, models[input.next8() % 3], RL);
+	driver.setTimeToRead(input.next8() % 8);
+
+	for(uint8_t operation = 0; operation < FUZZ_MAX_OPERATIONS && !input.isEmpty(); operation++) {
+		switch(input.next8() % 11) {
+			case 0 :
+				driver.setEnv((int8_t)input.next8(), input.next8(), input.next16());
+				break;
+			case 1 :
+				driver.setR0(input.nextFloat());
+				break;
+			case 2 : {
+				float a = input.nextFloat();
+				driver.setCurve(a, input.next8() & 1 ? input.nextFloat() : (int16_t)input.next16() / 2048.0);
+				break;
+			}
+			case 3 :
+				driver.setTimeToRead(input.next8() % 8);
+				break;
+			case 4 :
+				driver.setPressureCompensation(input.next8() & 1);
+				break;
+			case 5 :
+				if(input.next8() & 1) {
+					driver.enableLookupTable(table, MQ131_ADC_STEPS);
+				} else {
+					driver.disableLookupTable();
+				}
+				break;
+			case 6 :
+				checkCalibration(driver);
+				break;
+			case 7 :
+				checkMonotonic(driver, circuit);
+				break;
+			case 8 :
+				if(input.next8() & 1) {
+					driver.enableFilter(window, 1 + input.next8() % MQ131_FILTER_MAX_WINDOW, input.next8() / 16.0);
+				} else {
+					driver.disableFilter();
+				}
+				break;
+			default :
+				driver.sample();
+				checkReading(driver);
+				break;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Entry point of libFuzzer
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	FuzzInput input(data, size, 0);
+	return runInput(input);
+}
+
+#ifndef MQ131_LIBFUZZER
+int main(int argc, char** argv) {
+	uint32_t runs = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+	uint32_t firstSeed = argc > 2 ? strtoul(argv[2], NULL, 10) : 1;
+
+	for(fuzzSeed = firstSeed; fuzzSeed < firstSeed + runs; fuzzSeed++) {
+		FuzzInput input(NULL, 0, fuzzSeed);
+		runInput(input);
+	}
+	printf("%u runs passed (seeds %u to %u)\n", runs, firstSeed, firstSeed + runs - 1);
+	return 0;
+}
+#endif
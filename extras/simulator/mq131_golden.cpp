@@ -0,0 +1,439 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Verification of the driver against the datasheet curves (host only)        *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+// Compare the driver with the points of the datasheets, exported in
+// extras/datasheet (golden data, also used by the fit scripts):
+// - mq131_sensitivity.csv: Rs/R0 for each concentration and model
+// - mq131_environment.csv: Rs/R0 for each temperature and humidity
+// The driver reads exactly the Rs of each point: the load resistance is
+// chosen equal to Rs, so the ADC code is half of the scale.
+// Three checks for each point:
+// - datasheet: the points are fitted again here (power law of each curve
+//   and line of each humidity, least squares, as the curves of the driver
+//   were). The driver must stay within the digitization error of the
+//   points from this fit: the points were read from the plots of the
+//   datasheets, so a curve differing by less than their reading precision
+//   fits them as well. The deviation from the points themselves is printed:
+//   it is the error of the model (the power law without offset misses the
+//   points by up to about 25% at 10 ppb/ppm, the lines by up to about 4%).
+//   The correction is relative to 20°C 60% (1 there), so the points of the
+//   environment are divided by the fitted 60% line at 20°C. The SnO2
+//   points come from the published fit, the same curve as the driver: they
+//   are not checked against a bound
+// - output: the output of the driver stays within 0.1% of the value
+//   recorded below (any change of the math is seen, not only a large one)
+// - direction: an element following the environment curves of the datasheet
+//   (Rs/R0 higher when colder or drier) is read closer to the true
+//   concentration with the correction than without, for every model
+// The exit code is 1 if one of the checks fails.
+//
+// Build and run (from this directory):
+//   g++ -O2 -std=c++11 -I. -I../../src ../../src/*.cpp mq131_golden.cpp -o mq131_golden
+//   ./mq131_golden ../datasheet
+
+#include <stdlib.h>
+#include <vector>
+
+#include "MQ131.h"
+
+#define GOLDEN_PIN_POWER                            2
+#define GOLDEN_PIN_SENSOR                           14
+#define GOLDEN_R0                                   1000000           // R0 of the driver (large to have an exact load resistance in Ohms)
+#define GOLDEN_CURVE_READING_ERROR                  0.05              // Rs/R0 of the curves read with 2 significant digits on the
+                                                                      // log axis: half a step of 0.1 at Rs/R0 = 1 (relative)
+#define GOLDEN_ENV_READING_ERROR                    0.008             // Rs/R0 of the environment read to 0.01: half a step at the
+                                                                      // lowest point (0.64, relative)
+#define GOLDEN_ENV_TOLERANCE                        (2 * GOLDEN_ENV_READING_ERROR)
+                                                                      // Max deviation of the correction from the fitted lines
+                                                                      // (ratio of two readings: the point and the reference)
+#define GOLDEN_OUTPUT_TOLERANCE                     0.001             // Max deviation from the recorded outputs of the driver
+#define GOLDEN_DIRECTION_CONCENTRATION              100               // Concentration read in each environment (native unit)
+
+// Output of the driver recorded for a point of the curves (native unit)
+struct CurveOutput {
+	const char* model;
+	float concentration;
+	float expected;
+};
+
+// Environmental correction recorded for a point (Rs/R0 divided by it)
+struct EnvOutput {
+	int8_t temperature;
+	uint8_t humidity;
+	float expected;
+};
+
+// Point of the sensitivity curves of the datasheet
+struct CurvePoint {
+	uint8_t model;
+	float concentration;
+	float ratio;
+	bool fromFit;
+	char unit[8];
+};
+
+// Point of the environment curves of the datasheet
+struct EnvPoint {
+	int temperature;
+	int humidity;
+	float ratio;
+};
+
+// Humidity of the environment curves of the datasheet
+static const int envHumidities[] = {30, 60, 85};
+
+static const CurveOutput curveOutputs[] = {
+	{"LOW_CONCENTRATION", 10, 12.3493},
+	{"LOW_CONCENTRATION", 50, 42.4193},
+	{"LOW_CONCENTRATION", 100, 80.5082},
+	{"LOW_CONCENTRATION", 200, 213.997},
+	{"LOW_CONCENTRATION", 500, 529.176},
+	{"LOW_CONCENTRATION", 1000, 1046.7},
+	{"HIGH_CONCENTRATION", 10, 12.4476},
+	{"HIGH_CONCENTRATION", 50, 40.9193},
+	{"HIGH_CONCENTRATION", 100, 82.3316},
+	{"HIGH_CONCENTRATION", 200, 217.882},
+	{"HIGH_CONCENTRATION", 500, 529.026},
+	{"HIGH_CONCENTRATION", 1000, 1034.06},
+	{"SN_O2_LOW_CONCENTRATION", 10, 10},
+	{"SN_O2_LOW_CONCENTRATION", 20, 20},
+	{"SN_O2_LOW_CONCENTRATION", 50, 49.9998},
+	{"SN_O2_LOW_CONCENTRATION", 100, 99.9982},
+	{"SN_O2_LOW_CONCENTRATION", 200, 200.002},
+	{"SN_O2_LOW_CONCENTRATION", 500, 500},
+	{"SN_O2_LOW_CONCENTRATION", 1000, 1000.1},
+};
+
+static const EnvOutput envOutputs[] = {
+	{-10, 30, 1.56539},
+	{-5, 30, 1.5006},
+	{0, 30, 1.43581},
+	{10, 30, 1.30622},
+	{20, 30, 1.17664},
+	{30, 30, 1.04705},
+	{40, 30, 0.917471},
+	{50, 30, 0.787887},
+	{-10, 60, 1.3281},
+	{-5, 60, 1.27341},
+	{0, 60, 1.21873},
+	{10, 60, 1.10937},
+	{20, 60, 1},
+	{30, 60, 0.890635},
+	{40, 60, 0.78127},
+	{50, 60, 0.671905},
+	{-10, 85, 1.15219},
+	{-5, 85, 1.10486},
+	{0, 85, 1.05753},
+	{10, 85, 0.96287},
+	{20, 85, 0.868211},
+	{30, 85, 0.773551},
+	{40, 85, 0.67889},
+	{50, 85, 0.58423},
+};
+
+/**
+ * Circuit giving a fixed ADC code, with a clock that doesn't wait
+ */
+class FixedCircuit : public MQ131Hal {
+	public:
+		void setPinMode(uint8_t, uint8_t) {}
+		void writePin(uint8_t, uint8_t) {}
+		uint16_t readAnalog(uint8_t) { return MQ131_ADC_STEPS / 2; }
+		uint32_t getMillis() { return clockMs; }
+		void wait(uint32_t ms) { clockMs += ms; }
+
+	private:
+		uint32_t clockMs = 0;
+};
+
+/**
+ * Concentration read by the driver for Rs/R0 in the given environment
+ * (native unit of the model)
+ */
+static float readO3(MQ131Model model, float ratio, int8_t tempCels, uint8_t humPc) {
+	FixedCircuit circuit;
+	uint32_t RL = lround(ratio * GOLDEN_R0);
+	MQ131Class driver(RL);
+	driver.setHal(&circuit);
+	driver.begin(GOLDEN_PIN_POWER, GOLDEN_PIN_SENSOR, model, RL);
+	driver.setR0(GOLDEN_R0);
+	driver.setTimeToRead(0);
+	driver.setEnv(tempCels, humPc);
+	driver.sample();
+	return driver.getO3(model == HIGH_CONCENTRATION ? PPM : PPB);
+}
+
+/**
+ * Curve of a model (concentration = a * (Rs/R0)^b, native unit)
+ */
+static void getCurve(MQ131Model model, float& a, float& b) {
+	FixedCircuit circuit;
+	MQ131Class driver(GOLDEN_R0);
+	driver.setHal(&circuit);
+	driver.begin(GOLDEN_PIN_POWER, GOLDEN_PIN_SENSOR, model, GOLDEN_R0);
+	a = driver.getCurveA();
+	b = driver.getCurveB();
+}
+
+/**
+ * Deviation of an output from its recorded value (printed, infinite
+ * when there is no recorded value)
+ */
+static float checkOutput(float value, const float* expected) {
+	if(expected == NULL) {
+		printf(";none;-\n");
+		return INFINITY;
+	}
+	float deviation = value / *expected - 1.0;
+	printf(";%.6g;%.3f\n", *expected, 100.0 * deviation);
+	return fabs(deviation);
+}
+
+/**
+ * Least squares line y = slope * x + intercept
+ */
+static void fitLine(const std::vector<double>& x, const std::vector<double>& y, double& slope, double& intercept) {
+	double sumX = 0;
+	double sumY = 0;
+	double sumXX = 0;
+	double sumXY = 0;
+	for(size_t i = 0; i < x.size(); i++) {
+		sumX += x[i];
+		sumY += y[i];
+		sumXX += x[i] * x[i];
+		sumXY += x[i] * y[i];
+	}
+	double n = x.size();
+	slope = (n * sumXY - sumX * sumY) / (n * sumXX - sumX * sumX);
+	intercept = (sumY - slope * sumX) / n;
+}
+
+/**
+ * Open one file of the golden data (header line skipped)
+ */
+static FILE* openGolden(const char* directory, const char* name) {
+	char path[256];
+	char header[256];
+	snprintf(path, sizeof(path), "%s/%s", directory, name);
+	FILE* file = fopen(path, "r");
+	if(file == NULL || fgets(header, sizeof(header), file) == NULL) {
+		fprintf(stderr, "Cannot read %s\n", path);
+		exit(2);
+	}
+	return file;
+}
+
+int main(int argc, char** argv) {
+	const char* directory = argc > 1 ? argv[1] : "../datasheet";
+	const char* modelNames[] = {"LOW_CONCENTRATION", "HIGH_CONCENTRATION", "SN_O2_LOW_CONCENTRATION"};
+	const MQ131Model models[] = {LOW_CONCENTRATION, HIGH_CONCENTRATION, SN_O2_LOW_CONCENTRATION};
+	float maxDeviation[3] = {0, 0, 0};
+	float maxOutputDeviation = 0;
+	bool failed = false;
+	char line[256];
+
+	// Points of the curves
+	FILE* file = openGolden(directory, "mq131_sensitivity.csv");
+	std::vector<CurvePoint> curvePoints;
+	while(fgets(line, sizeof(line), file) != NULL) {
+		char name[32];
+		char source[128] = "";
+		CurvePoint point;
+		if(sscanf(line, "%31[^,],%7[^,],%f,%f,%127[^\n]", name, point.unit, &point.concentration, &point.ratio, source) < 4) {
+			continue;
+		}
+		for(uint8_t m = 0; m < 3; m++) {
+			if(strcmp(name, modelNames[m]) == 0) {
+				point.model = m;
+				// Points taken from a fit are not independent of the driver
+				point.fromFit = strstr(source, " fit ") != NULL;
+				curvePoints.push_back(point);
+			}
+		}
+	}
+	fclose(file);
+
+	// Power law of each model fitted on its points (log domain)
+	double fitA[3] = {0, 0, 0};
+	double fitB[3] = {0, 0, 0};
+	for(uint8_t m = 0; m < 3; m++) {
+		std::vector<double> x;
+		std::vector<double> y;
+		for(size_t p = 0; p < curvePoints.size(); p++) {
+			if(curvePoints[p].model == m && !curvePoints[p].fromFit) {
+				x.push_back(log(curvePoints[p].ratio));
+				y.push_back(log(curvePoints[p].concentration));
+			}
+		}
+		if(x.size() >= 2) {
+			double intercept;
+			fitLine(x, y, fitB[m], intercept);
+			fitA[m] = exp(intercept);
+		}
+	}
+
+	// Curve of each model (reference environment 20°C 60%)
+	printf("model;concentration;Rs/R0;driver;deviation from the point (%%);deviation from the fit (%%);recorded;output deviation (%%)\n");
+	for(size_t p = 0; p < curvePoints.size(); p++) {
+		const CurvePoint& point = curvePoints[p];
+		uint8_t m = point.model;
+		float value = readO3(models[m], point.ratio, 20, 60);
+		printf("%s;%g %s;%g;%.2f;", modelNames[m], point.concentration, point.unit, point.ratio, value);
+		if(point.fromFit) {
+			printf("fit;fit");
+		} else {
+			float deviation = value / (fitA[m] * pow(point.ratio, fitB[m])) - 1.0;
+			printf("%.1f;%.2f", 100.0 * (value / point.concentration - 1.0), 100.0 * deviation);
+			if(fabs(deviation) > maxDeviation[m]) {
+				maxDeviation[m] = fabs(deviation);
+			}
+		}
+		const float* expected = NULL;
+		for(uint8_t i = 0; i < sizeof(curveOutputs) / sizeof(curveOutputs[0]); i++) {
+			if(strcmp(curveOutputs[i].model, modelNames[m]) == 0 && curveOutputs[i].concentration == point.concentration) {
+				expected = &curveOutputs[i].expected;
+			}
+		}
+		float outputDeviation = checkOutput(value, expected);
+		if(outputDeviation > maxOutputDeviation) {
+			maxOutputDeviation = outputDeviation;
+		}
+	}
+
+	// Points of the environment, line of each humidity fitted on them
+	file = openGolden(directory, "mq131_environment.csv");
+	std::vector<EnvPoint> points;
+	while(fgets(line, sizeof(line), file) != NULL) {
+		EnvPoint point;
+		if(sscanf(line, "%d,%d,%f", &point.temperature, &point.humidity, &point.ratio) == 3) {
+			points.push_back(point);
+		}
+	}
+	fclose(file);
+	const uint8_t humidityCount = sizeof(envHumidities) / sizeof(envHumidities[0]);
+	double slopes[humidityCount];
+	double intercepts[humidityCount];
+	for(uint8_t h = 0; h < humidityCount; h++) {
+		std::vector<double> x;
+		std::vector<double> y;
+		for(size_t p = 0; p < points.size(); p++) {
+			if(points[p].humidity == envHumidities[h]) {
+				x.push_back(points[p].temperature);
+				y.push_back(points[p].ratio);
+			}
+		}
+		fitLine(x, y, slopes[h], intercepts[h]);
+	}
+	// The correction is relative to 20°C 60% (fitted 60% line)
+	double envReference = slopes[1] * 20 + intercepts[1];
+
+	// Environmental correction: ratio of the readings at Rs/R0 = 1 without
+	// and with the correction, back to Rs/R0 with the exponent of the curve
+	// Direction: the element of each model follows the datasheet curve at
+	// GOLDEN_DIRECTION_CONCENTRATION, the correction must reduce the error
+	float maxEnvDeviation = 0;
+	uint16_t wrongDirections = 0;
+	float curveA[3];
+	float curveB[3];
+	for(uint8_t m = 0; m < 3; m++) {
+		getCurve(models[m], curveA[m], curveB[m]);
+	}
+	printf("\ntemperature;humidity;Rs/R0 relative to 20°C 60%%;driver;deviation from the point (%%);"
+	       "deviation from the fit (%%);recorded;output deviation (%%)\n");
+	float reference = readO3(LOW_CONCENTRATION, 1.0, 20, 60);
+	for(size_t p = 0; p < points.size(); p++) {
+		EnvPoint& point = points[p];
+		point.ratio /= envReference;
+		double fit = NAN;
+		for(uint8_t h = 0; h < humidityCount; h++) {
+			if(point.humidity == envHumidities[h]) {
+				fit = (slopes[h] * point.temperature + intercepts[h]) / envReference;
+			}
+		}
+		float value = readO3(LOW_CONCENTRATION, 1.0, point.temperature, point.humidity);
+		float correction = pow(reference / value, 1.0 / curveB[0]);
+		float deviation = correction / fit - 1.0;
+		printf("%d;%d;%.3f;%.3f;%.1f;%.2f", point.temperature, point.humidity, point.ratio, correction,
+		       100.0 * (correction / point.ratio - 1.0), 100.0 * deviation);
+		// Not a point of the curves (NaN): fails
+		if(!(fabs(deviation) <= maxEnvDeviation)) {
+			maxEnvDeviation = isnan(deviation) ? INFINITY : fabs(deviation);
+		}
+		const float* expected = NULL;
+		for(uint8_t i = 0; i < sizeof(envOutputs) / sizeof(envOutputs[0]); i++) {
+			if(envOutputs[i].temperature == point.temperature && envOutputs[i].humidity == point.humidity) {
+				expected = &envOutputs[i].expected;
+			}
+		}
+		float outputDeviation = checkOutput(correction, expected);
+		if(outputDeviation > maxOutputDeviation) {
+			maxOutputDeviation = outputDeviation;
+		}
+	}
+
+	printf("\ntemperature;humidity;model;error without correction (%%);error with correction (%%);direction\n");
+	for(size_t p = 0; p < points.size(); p++) {
+		for(uint8_t m = 0; m < 3; m++) {
+			float concentration = GOLDEN_DIRECTION_CONCENTRATION;
+			float ratio = pow(concentration / curveA[m], 1.0 / curveB[m]) * points[p].ratio;
+			float errorRaw = readO3(models[m], ratio, 20, 60) / concentration - 1.0;
+			float errorCorrected = readO3(models[m], ratio, points[p].temperature, points[p].humidity) / concentration - 1.0;
+			// Not checked in the reference environment (the correction is 1)
+			// nor when the effect is within the digitization error
+			bool checked = !(points[p].temperature == 20 && points[p].humidity == 60)
+			               && fabs(points[p].ratio - 1.0) > GOLDEN_ENV_TOLERANCE;
+			bool right = fabs(errorCorrected) < fabs(errorRaw);
+			printf("%d;%d;%s;%.1f;%.1f;%s\n", points[p].temperature, points[p].humidity, modelNames[m],
+			       100.0 * errorRaw, 100.0 * errorCorrected, !checked ? "-" : right ? "ok" : "WRONG");
+			if(checked && !right) {
+				wrongDirections++;
+			}
+		}
+	}
+
+	printf("\ncheck;max deviation;tolerance\n");
+	for(uint8_t m = 0; m < 3; m++) {
+		if(models[m] == SN_O2_LOW_CONCENTRATION) {
+			printf("%s;fit;-\n", modelNames[m]);
+			continue;
+		}
+		// Reading error of Rs/R0, in concentration through the exponent
+		float tolerance = pow(1.0 + GOLDEN_CURVE_READING_ERROR, fabs(fitB[m])) - 1.0;
+		printf("%s;%.2f%%;%.1f%%\n", modelNames[m], 100.0 * maxDeviation[m], 100.0 * tolerance);
+		failed |= maxDeviation[m] > tolerance;
+	}
+	printf("environment;%.2f%%;%.1f%%\n", 100.0 * maxEnvDeviation, 100.0 * GOLDEN_ENV_TOLERANCE);
+	failed |= maxEnvDeviation > GOLDEN_ENV_TOLERANCE;
+	printf("recorded outputs;%.3f%%;%.1f%%\n", 100.0 * maxOutputDeviation, 100.0 * GOLDEN_OUTPUT_TOLERANCE);
+	failed |= maxOutputDeviation > GOLDEN_OUTPUT_TOLERANCE;
+	printf("wrong directions;%u;0\n", wrongDirections);
+	failed |= wrongDirections > 0;
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,219 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Check of the log recovery on a file-backed storage (host only)             *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+// Run MQ131LogClass on MQ131FileStorage (image of a NOR flash: page of 128
+// bytes, block of 256 bytes, 2 KB so the log wraps quickly) and damage the
+// file between two begin() of the log, as a power loss would:
+// - wrap-around: 1000 records on 64 slots, then reopen
+// - power loss: records appended but not flushed, including the first
+//   record of a block (its block is already erased)
+// - torn record: bytes of the last record cleared (write cut in the middle)
+// - truncated file: the file ends in the middle of the last record (the
+//   end of the file reads as erased)
+// - corrupted block: the first record of the last block and of an older
+//   block are damaged (the recovery must look further in these blocks)
+// After each reopen, the end of the log must be found again, every record
+// read must be exactly the one appended (a damaged record is refused, never
+// returned with wrong fields) and the records not damaged must be readable.
+// The appends continue after each scenario. The exit code is 1 if one of
+// the checks fails.
+//
+// Build and run (from this directory):
+//   g++ -O2 -std=c++11 -I. -I../../src ../../src/*.cpp MQ131FileStorage.cpp mq131_log.cpp -o mq131_log
+//   ./mq131_log [file]
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "MQ131Log.h"
+#include "MQ131FileStorage.h"
+
+#define LOG_SIZE                                    2048              // Size of the storage (bytes)
+#define LOG_PAGE_SIZE                               128               // Program page (bytes)
+#define LOG_ERASE_SIZE                              256               // Erase block (bytes)
+#define LOG_CAPACITY                                (LOG_SIZE / MQ131_LOG_RECORD_SIZE)
+#define LOG_RECORDS_PER_BLOCK                       (LOG_ERASE_SIZE / MQ131_LOG_RECORD_SIZE)
+#define LOG_WRAP_RECORDS                            1000              // Records of the wrap-around scenario
+#define LOG_DEFAULT_FILE                            "mq131_log.bin"
+
+static const char* logPath = LOG_DEFAULT_FILE;
+static MQ131FileStorage storage;
+static MQ131LogClass logger;
+static uint8_t buffer[LOG_PAGE_SIZE];
+
+/**
+ * Fields of the record appended with a sequence
+ */
+static uint32_t expectedTimestamp(uint32_t sequence) { return sequence * 60; }
+static float expectedPpb(uint32_t sequence) { return sequence * 0.5; }
+static uint16_t expectedAdc(uint32_t sequence) { return sequence % 1024; }
+static uint8_t expectedLoadResistor(uint32_t sequence) { return sequence % 3; }
+static uint32_t expectedRL(uint32_t sequence) { return 1000 * (sequence % 3 + 1); }
+static float expectedSupply(uint32_t sequence) { return 1000 + sequence % 48 * 0.5; }
+
+/**
+ * Append records up to a sequence (flushed or not)
+ */
+static bool appendTo(uint32_t sequence, bool flush) {
+	while(logger.getNextSequence() < sequence) {
+		uint32_t next = logger.getNextSequence();
+		if(!logger.append(expectedTimestamp(next), expectedPpb(next), expectedAdc(next), expectedRL(next),
+		                  expectedSupply(next), expectedLoadResistor(next))) {
+			return false;
+		}
+	}
+	return !flush || logger.flush();
+}
+
+/**
+ * Close the file without flushing the log (power loss) and open it again
+ */
+static bool reopen() {
+	storage.end();
+	logger = MQ131LogClass();
+	return storage.begin(logPath, LOG_SIZE, LOG_PAGE_SIZE, LOG_ERASE_SIZE) && logger.begin(&storage, buffer);
+}
+
+/**
+ * Clear bytes of the file (a write cut in the middle only clears bits)
+ */
+static bool damage(uint32_t sequence, uint8_t offset, uint8_t length) {
+	storage.end();
+	FILE* file = fopen(logPath, "r+b");
+	if(file == NULL) {
+		return false;
+	}
+	uint8_t zeros[MQ131_LOG_RECORD_SIZE] = {0};
+	bool done = fseek(file, (sequence % LOG_CAPACITY) * MQ131_LOG_RECORD_SIZE + offset, SEEK_SET) == 0
+	            && fwrite(zeros, 1, length, file) == length;
+	return fclose(file) == 0 && done;
+}
+
+/**
+ * Check the log after a reopen: its end, the records damaged (refused)
+ * and all the others (exact)
+ */
+static bool checkLog(const char* name, uint32_t expectedNext, const std::vector<uint32_t>& damaged) {
+	uint32_t recoveryReads = storage.getReadCount();
+	uint32_t first = logger.getFirstSequence();
+	uint32_t next = logger.getNextSequence();
+	uint32_t readable = 0;
+	uint32_t wrong = 0;
+	uint32_t missing = 0;
+	for(uint32_t sequence = first; sequence < next; sequence++) {
+		bool isDamaged = false;
+		for(size_t i = 0; i < damaged.size(); i++) {
+			isDamaged |= damaged[i] == sequence;
+		}
+		MQ131Record record;
+		if(!logger.read(sequence, record)) {
+			missing += isDamaged ? 0 : 1;
+			continue;
+		}
+		readable++;
+		if(isDamaged || record.timestamp != expectedTimestamp(sequence) || record.ppb != expectedPpb(sequence)
+		   || record.adc != expectedAdc(sequence) || record.loadResistor != expectedLoadResistor(sequence)
+		   || record.rl != expectedRL(sequence) || record.supply != expectedSupply(sequence)) {
+			wrong++;
+		}
+	}
+	bool passed = next == expectedNext && wrong == 0 && missing == 0;
+	printf("%s;%u;%u;%u;%u;%u;%u;%s\n", name, first, next, readable, missing, wrong, recoveryReads,
+	       passed ? "ok" : "FAILED");
+	return passed;
+}
+
+int main(int argc, char** argv) {
+	bool passed = true;
+	std::vector<uint32_t> damaged;
+	if(argc > 1) {
+		logPath = argv[1];
+	}
+	remove(logPath);
+	if(!reopen()) {
+		fprintf(stderr, "Cannot open %s\n", logPath);
+		return 1;
+	}
+	printf("scenario;first sequence;next sequence;readable;missing;wrong;reads of the recovery;check\n");
+
+	// Wrap-around: the storage is reused about 8 times
+	passed &= appendTo(LOG_WRAP_RECORDS, true) && reopen();
+	passed &= checkLog("wrap-around", LOG_WRAP_RECORDS, damaged);
+
+	// Power loss inside a page: the records not flushed are lost
+	uint32_t flushed = logger.getNextSequence();
+	passed &= appendTo(flushed + 3, false) && reopen();
+	passed &= checkLog("power loss in a page", flushed, damaged);
+
+	// Power loss after the erase of a new block (oldest records lost)
+	uint32_t boundary = flushed + LOG_RECORDS_PER_BLOCK - flushed % LOG_RECORDS_PER_BLOCK;
+	passed &= appendTo(boundary, true) && appendTo(boundary + 2, false) && reopen();
+	passed &= checkLog("power loss in a new block", boundary, damaged);
+
+	// Torn record: the slot is used, the record is refused
+	uint32_t torn = boundary + 5;
+	passed &= appendTo(torn + 1, true) && damage(torn, 4, 6) && reopen();
+	damaged.push_back(torn);
+	passed &= checkLog("torn record", torn + 1, damaged);
+	passed &= appendTo(torn + 10, true) && reopen();
+	passed &= checkLog("appends after the torn record", torn + 10, damaged);
+
+	// Truncated file: the end of the last record reads as erased, as the
+	// older records after it on the storage
+	uint32_t last = logger.getNextSequence() - 1;
+	storage.end();
+	passed &= truncate(logPath, (last % LOG_CAPACITY) * MQ131_LOG_RECORD_SIZE + 7) == 0;
+	passed &= reopen();
+	damaged.push_back(last);
+	for(uint32_t sequence = logger.getFirstSequence(); sequence < last; sequence++) {
+		if(sequence % LOG_CAPACITY > last % LOG_CAPACITY) {
+			damaged.push_back(sequence);
+		}
+	}
+	passed &= checkLog("truncated file", last + 1, damaged);
+	passed &= appendTo(last + 20, true) && reopen();
+	passed &= checkLog("appends after the truncation", last + 20, damaged);
+
+	// Corrupted first records: of the last block and of an older block
+	uint32_t lastBlock = logger.getNextSequence() - 1;
+	lastBlock -= lastBlock % LOG_RECORDS_PER_BLOCK;
+	uint32_t olderBlock = lastBlock - 3 * LOG_RECORDS_PER_BLOCK;
+	passed &= damage(lastBlock, 0, MQ131_LOG_RECORD_SIZE) && damage(olderBlock, 0, 2) && reopen();
+	damaged.push_back(lastBlock);
+	damaged.push_back(olderBlock);
+	passed &= checkLog("corrupted blocks", last + 20, damaged);
+	passed &= appendTo(last + 20 + LOG_CAPACITY, true) && reopen();
+	passed &= checkLog("appends over the damaged storage", last + 20 + LOG_CAPACITY, damaged);
+
+	storage.end();
+	remove(logPath);
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Timing of the math options of the curve (host only)                        *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+// Time the computation of the concentration with the math option of the
+// driver (MQ131_POW_PRECISION) next to log() and exp() of the C library:
+// - libm: log() then exp() on the Rs of every ADC code (the calls of the
+//   driver when MQ131_POW_PRECISION is 0)
+// - reading: one entry of the lookup table (Rs, log, curve, exp), the
+//   table is built again at each pass
+// - getO3(): one exponential and the unit
+// - sample(): the cycle with a circuit that doesn't wait (one logarithm)
+// Each line prints the time per call (ns) and the cycles of the time
+// stamp counter on x86 (0 elsewhere). The math option is chosen at
+// compilation, build once per option to compare them:
+//   for p in 0 1 2; do
+//     g++ -O2 -std=c++11 -DMQ131_POW_PRECISION=$p -I. -I../../src ../../src/*.cpp mq131_math.cpp -o mq131_math
+//     ./mq131_math
+//   done
+// On a board without floating point unit, the gap between the options is
+// much larger than on the host (log() and exp() in soft float).
+
+#include <stdlib.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "MQ131.h"
+
+#define MATH_PIN_POWER                              2
+#define MATH_PIN_SENSOR                             14
+#define MATH_RL                                     10000             // Load resistance (Ohms)
+#define MATH_PASSES                                 10000             // Passes over the ADC codes
+
+/**
+ * Circuit giving the ADC codes in turn, with a clock that doesn't wait
+ */
+class SweepCircuit : public MQ131Hal {
+	public:
+		void setPinMode(uint8_t, uint8_t) {}
+		void writePin(uint8_t, uint8_t) {}
+		uint16_t readAnalog(uint8_t) { code = (code + 1) % MQ131_ADC_STEPS; return code; }
+		uint32_t getMillis() { return clockMs; }
+		void wait(uint32_t ms) { clockMs += ms; }
+
+	private:
+		uint16_t code = 0;
+		uint32_t clockMs = 0;
+};
+
+/**
+ * Time stamp counter (0 when not available)
+ */
+static uint64_t getCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Timer of a loop, prints the time and the cycles per call
+ */
+class LoopTimer {
+	public:
+		LoopTimer() : start(std::chrono::steady_clock::now()), startCycles(getCycles()) {}
+
+		void print(const char* name, uint64_t calls) {
+			uint64_t cycles = getCycles() - startCycles;
+			double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			printf("%d;%s;%.1f;%.0f\n", MQ131_POW_PRECISION, name, ns / calls, (double)cycles / calls);
+		}
+
+	private:
+		std::chrono::steady_clock::time_point start;
+		uint64_t startCycles;
+};
+
+int main() {
+	static uint16_t table[MQ131_ADC_STEPS];
+	static float rs[MQ131_ADC_STEPS];
+	uint64_t calls = (uint64_t)MATH_PASSES * MQ131_ADC_STEPS;
+	// Sum of the results, printed so the loops are not removed
+	float checksum = 0;
+
+	SweepCircuit circuit;
+	MQ131Class driver(MATH_RL);
+	driver.setHal(&circuit);
+	driver.begin(MATH_PIN_POWER, MATH_PIN_SENSOR, LOW_CONCENTRATION, MATH_RL);
+	driver.setTimeToRead(0);
+	float b = driver.getCurveB();
+	for(uint16_t code = 0; code < MQ131_ADC_STEPS; code++) {
+		rs[code] = ((float)MQ131_ADC_STEPS / (code + 0.5f) - 1.0f) * MATH_RL;
+	}
+
+	printf("precision;operation;time (ns);cycles\n");
+	LoopTimer libm;
+	for(uint16_t pass = 0; pass < MATH_PASSES; pass++) {
+		for(uint16_t code = 0; code < MQ131_ADC_STEPS; code++) {
+			checksum += exp(b * log(rs[code]));
+		}
+	}
+	libm.print("libm log() + exp()", calls);
+
+	// The table is built by getO3() after a reading
+	driver.sample();
+	LoopTimer reading;
+	for(uint16_t pass = 0; pass < MATH_PASSES; pass++) {
+		driver.enableLookupTable(table, MQ131_ADC_STEPS);
+		checksum += driver.getO3(PPB);
+	}
+	reading.print("reading (lookup table entry)", calls);
+	driver.disableLookupTable();
+
+	driver.sample();
+	LoopTimer getO3;
+	for(uint64_t call = 0; call < calls; call++) {
+		checksum += driver.getO3(call % 2 ? PPB : PPM);
+	}
+	getO3.print("getO3()", calls);
+
+	uint64_t samples = calls / 16;
+	LoopTimer sample;
+	for(uint64_t call = 0; call < samples; call++) {
+		driver.sample();
+	}
+	sample.print("sample()", samples);
+
+	printf("checksum;%g\n", checksum);
+	return 0;
+}
@@ -0,0 +1,234 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Double precision reference and error budget of the driver (host only)      *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+// The chain of the driver (Rs from the ADC code, environmental correction,
+// curve, unit) written again in double precision, straight from the
+// equations, as the reference for every faster implementation.
+//
+// The driver is swept over every ADC code, model, unit and environment
+// (temperature, humidity, pressure) and compared to the reference. Each
+// implementation is reported with its max and mean relative error:
+// - float: the driver as built (see MQ131_POW_PRECISION below)
+// - table: the driver with the lookup table (small floats, relative step
+//   of 0.05%, within MQ131_LUT_MAX_ERROR of the float computation)
+// The math option is chosen at compilation, build once per option to
+// compare them:
+//   for p in 0 1 2; do
+//     g++ -O2 -std=c++11 -DMQ131_POW_PRECISION=$p -I. -I../../src ../../src/*.cpp mq131_reference.cpp -o mq131_reference
+//     ./mq131_reference
+//   done
+// The exit code is 1 if a max error is above the tolerance given as
+// argument (in %, e.g. ./mq131_reference 0.01), to use it as a check
+// (plus MQ131_LUT_MAX_ERROR for the table).
+
+#include <stdlib.h>
+
+#include "MQ131.h"
+
+#define REF_PIN_POWER                               2
+#define REF_PIN_SENSOR                              14
+#define REF_RL                                      10000             // Load resistance (Ohms)
+#define REF_MIN_CONCENTRATION_PPB                   0.1               // Concentrations below are not compared (relative error meaningless)
+#define REF_MAX_CONCENTRATION_PPB                   1.0e7             // Concentrations above are not compared (out of any range)
+
+/**
+ * Circuit giving a fixed ADC code, with a clock that doesn't wait
+ */
+class FixedCircuit : public MQ131Hal {
+	public:
+		void setPinMode(uint8_t, uint8_t) {}
+		void writePin(uint8_t, uint8_t) {}
+		uint16_t readAnalog(uint8_t) { return code; }
+		uint32_t getMillis() { return clockMs; }
+		void wait(uint32_t ms) { clockMs += ms; }
+
+		uint16_t code = 0;
+
+	private:
+		uint32_t clockMs = 0;
+};
+
+/**
+ * Reference: Rs from the ADC code (sensor powered by the ADC reference)
+ */
+static double refRs(uint16_t code, double RL) {
+	return ((double)MQ131_ADC_STEPS / code - 1.0) * RL;
+}
+
+/**
+ * Reference: environmental correction of Rs/R0 (datasheet curves)
+ */
+static double refEnvCorrectRatio(double tempCels, double humPc) {
+	double dry = -0.0141 * tempCels + 1.5623;
+	double medium = -0.0119 * tempCels + 1.3261;
+	double humid = -0.0103 * tempCels + 1.1507;
+	double ratio = humid;
+	if(humPc <= 30) {
+		ratio = dry;
+	} else if(humPc < 60) {
+		ratio = dry + (medium - dry) * (humPc - 30) / 30.0;
+	} else if(humPc < 85) {
+		ratio = medium + (humid - medium) * (humPc - 60) / 25.0;
+	}
+	ratio /= -0.0119 * 20 + 1.3261;
+	return ratio < MQ131_MIN_ENV_CORRECT_RATIO ? MQ131_MIN_ENV_CORRECT_RATIO : ratio;
+}
+
+/**
+ * Reference: curve of each model in its native unit (ppb or ppm)
+ */
+static double refCurve(MQ131Model model, double ratio) {
+	switch(model) {
+		case LOW_CONCENTRATION :
+			return 9.4783 * pow(ratio, 2.3348);
+		case HIGH_CONCENTRATION :
+			return 8.1399 * pow(ratio, 2.3297);
+		default :
+			return 26.941 * pow(12.15 * ratio, -1.16);
+	}
+}
+
+/**
+ * Reference: concentration in ppb
+ */
+static double refO3(MQ131Model model, double rs, double R0, double tempCels, double humPc, double pressureHPa) {
+	double ratio = rs / R0 / refEnvCorrectRatio(tempCels, humPc);
+	double native = refCurve(model, ratio) * MQ131_REFERENCE_PRESSURE_HPA / pressureHPa;
+	return model == HIGH_CONCENTRATION ? native * 1000.0 : native;
+}
+
+/**
+ * Reference: conversion from ppb to any unit (ideal gas)
+ */
+static double refConvert(double ppb, MQ131Unit unit, double tempCels, double pressureHPa) {
+	double molarVolume = 83.14462618 * (tempCels + 273.15) / pressureHPa;
+	switch(unit) {
+		case PPM :
+			return ppb / 1000.0;
+		case PPB :
+			return ppb;
+		case MG_M3 :
+			return ppb / 1000.0 * 48.0 / molarVolume;
+		default :
+			return ppb * 48.0 / molarVolume;
+	}
+}
+
+/**
+ * Max and mean of the relative error of one implementation
+ */
+struct ErrorBudget {
+	double maxError = 0;
+	double sumError = 0;
+	uint32_t count = 0;
+	uint16_t worstCode = 0;
+	int8_t worstTemperature = 0;
+	uint8_t worstHumidity = 0;
+
+	void add(double value, double reference, uint16_t code, int8_t temperature, uint8_t humidity) {
+		double error = fabs(value / reference - 1.0);
+		if(!(error <= maxError)) {
+			maxError = error;
+			worstCode = code;
+			worstTemperature = temperature;
+			worstHumidity = humidity;
+		}
+		sumError += error;
+		count++;
+	}
+};
+
+int main(int argc, char** argv) {
+	double tolerance = argc > 1 ? atof(argv[1]) / 100.0 : -1;
+
+	const MQ131Model models[] = {LOW_CONCENTRATION, HIGH_CONCENTRATION, SN_O2_LOW_CONCENTRATION};
+	const char* modelNames[] = {"low", "high", "SnO2"};
+	const char* unitNames[] = {"ppm", "ppb", "mg/m3", "ug/m3"};
+	const int8_t temperatures[] = {-20, 0, 20, 40};
+	const uint8_t humidities[] = {20, 30, 45, 60, 65, 85, 95};
+	const uint16_t pressures[] = {900, 1013, 1050};
+
+	// Lookup table of the driver (one entry per ADC code)
+	static uint16_t table[MQ131_ADC_STEPS];
+
+	printf("MQ131_POW_PRECISION = %d, %d ADC codes\n", MQ131_POW_PRECISION, MQ131_ADC_STEPS);
+	printf("implementation;model;unit;max error (%%);mean error (%%);worst ADC code;worst temperature;worst humidity\n");
+	bool failed = false;
+	for(uint8_t m = 0; m < 3; m++) {
+		ErrorBudget budgets[2][UG_M3 + 1];
+		for(uint8_t lookup = 0; lookup < 2; lookup++) {
+			FixedCircuit circuit;
+			MQ131Class driver(REF_RL);
+			driver.setHal(&circuit);
+			driver.begin(REF_PIN_POWER, REF_PIN_SENSOR, models[m], REF_RL);
+			driver.setTimeToRead(0);
+			driver.setPressureCompensation(true);
+			if(lookup) {
+				driver.enableLookupTable(table, MQ131_ADC_STEPS);
+			}
+			for(uint8_t t = 0; t < sizeof(temperatures); t++) {
+				for(uint8_t h = 0; h < sizeof(humidities); h++) {
+					for(uint8_t p = 0; p < sizeof(pressures) / sizeof(pressures[0]); p++) {
+						driver.setEnv(temperatures[t], humidities[h], pressures[p]);
+						for(uint16_t code = 1; code < MQ131_ADC_STEPS; code++) {
+							circuit.code = code;
+							driver.sample();
+							double ppb = refO3(models[m], refRs(code, REF_RL), driver.getR0(),
+							                   temperatures[t], humidities[h], pressures[p]);
+							if(!(ppb >= REF_MIN_CONCENTRATION_PPB && ppb <= REF_MAX_CONCENTRATION_PPB)) {
+								continue;
+							}
+							for(uint8_t u = PPM; u <= UG_M3; u++) {
+								budgets[lookup][u].add(driver.getO3((MQ131Unit)u),
+								                       refConvert(ppb, (MQ131Unit)u, temperatures[t], pressures[p]),
+								                       code, temperatures[t], humidities[h]);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		for(uint8_t lookup = 0; lookup < 2; lookup++) {
+			for(uint8_t u = PPM; u <= UG_M3; u++) {
+				ErrorBudget& budget = budgets[lookup][u];
+				printf("%s;%s;%s;%.5f;%.5f;%u;%d;%u\n", lookup ? "table" : "float", modelNames[m], unitNames[u],
+				       100.0 * budget.maxError, 100.0 * budget.sumError / budget.count,
+				       budget.worstCode, budget.worstTemperature, budget.worstHumidity);
+				// The table adds its quantization to the error of the computation
+				double bound = lookup ? tolerance + MQ131_LUT_MAX_ERROR : tolerance;
+				if(tolerance >= 0 && !(budget.maxError <= bound)) {
+					failed = true;
+				}
+			}
+		}
+	}
+	return failed ? 1 : 0;
+}
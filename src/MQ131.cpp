@@ -31,10 +31,135 @@
 #include "MQ131.h"
 
 /**
- * Constructor, nothing special to do
+ * Default hardware access with the Arduino functions
+ */
+static MQ131Hal MQ131ArduinoHal;
+
+void MQ131Hal::setPinMode(uint8_t pin, uint8_t mode) {
+  pinMode(pin, mode);
+}
+
+void MQ131Hal::writePin(uint8_t pin, uint8_t value) {
+  digitalWrite(pin, value);
+}
+
+uint16_t MQ131Hal::readAnalog(uint8_t pin) {
+  return analogRead(pin);
+}
+
+uint32_t MQ131Hal::getMillis() {
+  return millis();
+}
+
+void MQ131Hal::wait(uint32_t ms) {
+  delay(ms);
+}
+
+/**
+ * Natural logarithm and exponential of the curve (log domain)
+ * When MQ131_POW_PRECISION is set, polynomials replace log()/exp()
+ * of the C library (slow in soft float): the exponent and the mantissa are
+ * taken from the bits of the float (IEEE 754), so only log2 on [1, 2[ and
+ * exp2 on [0, 1[ are approximated (minimax coefficients, max error in comment)
+ */
+static float logCurve(float x) {
+#if MQ131_POW_PRECISION == 0
+  return log(x);
+#else
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  int16_t exponent = (int16_t)((bits >> 23) & 0xFF) - 127;
+  // Zero, negative, subnormal, infinite or NaN: use the C library
+  if((bits & 0x80000000UL) || exponent == -127 || exponent == 128) {
+    return log(x);
+  }
+  bits = (bits & 0x007FFFFFUL) | 0x3F800000UL;
+  float t;
+  memcpy(&t, &bits, sizeof(t));
+  t -= 1.0f;
+#if MQ131_POW_PRECISION == 1
+  // log2(1 + t), error 5.0e-3
+  float log2x = exponent + t * (1.33489706f - 0.34483392f * t) + 0.00496877f;
+#else
+  // log2(1 + t), error 8.8e-5
+  float log2x = exponent + t * (1.43769706f + t * (-0.67492171f + t * (0.31865913f - 0.08161088f * t))) + 0.00008821f;
+#endif
+  return log2x * (float)M_LN2;
+#endif
+}
+
+static float expCurve(float x) {
+#if MQ131_POW_PRECISION == 0
+  return exp(x);
+#else
+  float z = x * (float)M_LOG2E;
+  // Out of the range of a normal float: use the C library
+  if(!(z > -125.0f && z < 127.0f)) {
+    return exp(x);
+  }
+  int16_t n = (int16_t)z;
+  if(n > z) {
+    n--;
+  }
+  float f = z - n;
+#if MQ131_POW_PRECISION == 1
+  // exp2(f), relative error 1.7e-3
+  float result = 1.00173472f + f * (0.65762135f + 0.33717444f * f);
+#else
+  // exp2(f), relative error 7.5e-5
+  float result = 0.99992473f + f * (0.69583618f + f * (0.22606562f + 0.07802293f * f));
+#endif
+  // Multiply by 2^n (add n to the exponent)
+  uint32_t bits;
+  memcpy(&bits, &result, sizeof(bits));
+  bits += (uint32_t)(int32_t)n << 23;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+#endif
+}
+
+/**
+ * Quantize a concentration into an entry of the lookup table: a small float
+ * with MQ131_LUT_MANTISSA_BITS of mantissa and the rest of exponent, so the
+ * relative step is the same over the whole range (MQ131_LUT_SATURATED if
+ * the value is out of range)
+ */
+static uint16_t encodeLookupEntry(float value) {
+  if(!(value > 0.0)) {
+    return MQ131_LUT_SATURATED;
+  }
+  int exponent;
+  // value = fraction * 2^exponent, fraction in [0.5, 1[
+  float fraction = frexp(value, &exponent);
+  uint16_t mantissa = (uint16_t)((2.0 * fraction - 1.0) * (1 << MQ131_LUT_MANTISSA_BITS) + 0.5);
+  exponent += MQ131_LUT_EXPONENT_BIAS - 1;
+  if(mantissa == (1 << MQ131_LUT_MANTISSA_BITS)) {
+    mantissa = 0;
+    exponent++;
+  }
+  if(exponent < 0 || exponent >= (1 << (16 - MQ131_LUT_MANTISSA_BITS))) {
+    return MQ131_LUT_SATURATED;
+  }
+  // The largest value is the marker of the values out of range
+  return (uint16_t)exponent << MQ131_LUT_MANTISSA_BITS | mantissa;
+}
+
+/**
+ * Value of an entry of the lookup table (no logarithm nor exponential)
+ */
+static float decodeLookupEntry(uint16_t entry) {
+  uint16_t mantissa = entry & ((1 << MQ131_LUT_MANTISSA_BITS) - 1);
+  int exponent = (int)(entry >> MQ131_LUT_MANTISSA_BITS) - MQ131_LUT_EXPONENT_BIAS;
+  return ldexp(1.0 + (float)mantissa / (1 << MQ131_LUT_MANTISSA_BITS), exponent);
+}
+
+/**
+ * Constructor, compute the default environmental factors
  */
 MQ131Class::MQ131Class(uint32_t _RL) {
   valueRL = _RL;
+  hal = &MQ131ArduinoHal;
+  updateEnvFactors();
 }
 
 /**
@@ -58,30 +183,48 @@ MQ131Class::~MQ131Class() {
  	pinPower = _pinPower;
  	pinSensor = _pinSensor;
  	valueRL = _RL;
+  lookupTableValid = false;
+  // Switchable load resistors set before begin(): keep the active one
+  // (and drive its pins with the current hardware access)
+  if(loadResistorCount > 0) {
+    selectLoadResistor(loadResistorIndex);
+  }
 
   // Setup default calibration value
   switch(model) {
     case LOW_CONCENTRATION :
       setR0(MQ131_DEFAULT_LO_CONCENTRATION_R0);
       setTimeToRead(MQ131_DEFAULT_LO_CONCENTRATION_TIME2READ);
+      // R^2 = 0.9906
+      // Use this if you are monitoring low concentration of O3 (air quality project)
+      // (R^2 = 0.9986 with 10.66435681 * ratio^2.25889394 - 10.66435681 but
+      // nearly impossible to have 0ppb)
+      setCurve(9.4783, 2.3348);
       break;
     case HIGH_CONCENTRATION :
       setR0(MQ131_DEFAULT_HI_CONCENTRATION_R0);
       setTimeToRead(MQ131_DEFAULT_HI_CONCENTRATION_TIME2READ);
+      // R^2 = 0.9900
+      // Use this if you are monitoring low concentration of O3 (air quality project)
+      // (R^2 = 0.9985 with 8.37768358 * ratio^2.30375446 - 8.37768358 but
+      // nearly impossible to have 0ppm)
+      setCurve(8.1399, 2.3297);
       break; 
     case SN_O2_LOW_CONCENTRATION:
       // Not tested by @ostaquet (I don't have this type of sensor)
       setR0(MQ131_DEFAULT_LO_CONCENTRATION_R0);
       setTimeToRead(MQ131_DEFAULT_LO_CONCENTRATION_TIME2READ);
+      // r^2 = 0.9956 with 26.941 * (12.15 * ratio)^-1.16
+      setCurve(26.941 * pow(12.15, -1.16), -1.16);
       break;
   }
 
  	// Setup pin mode
- 	pinMode(pinPower, OUTPUT);
- 	pinMode(pinSensor, INPUT);
+ 	hal->setPinMode(pinPower, OUTPUT);
+ 	hal->setPinMode(pinSensor, INPUT);
 
   // Switch off the heater as default status
-  digitalWrite(pinPower, LOW);
+  hal->writePin(pinPower, LOW);
  }
 
 /**
@@ -90,20 +233,304 @@ MQ131Class::~MQ131Class() {
  * of the read cycle!
  */
  void MQ131Class::sample() {
+ 	startSample();
+ 	while(!updateSample()) {
+ 		hal->wait(1000);
+ 	}
+ }
+
+/**
+ * Start a cycle without blocking (heater on)
+ */
+ void MQ131Class::startSample() {
  	startHeater();
- 	while(!isTimeToRead()) {
- 		delay(1000);
+ 	fingerprintSamples = 0;
+ }
+
+/**
+ * Continue a cycle started with startSample()
+ * Return true when the value is read and the heater stopped
+ */
+ bool MQ131Class::updateSample() {
+ 	if(!isTimeToRead()) {
+ 		if(fingerprintHistory != NULL) {
+ 			updateFingerprint();
+ 		}
+ 		return false;
+ 	}
+ 	// Refresh the pressure from the barometer (if any)
+ 	if(barometer != NULL) {
+ 		uint16_t pressure = barometer->getPressureHPa();
+ 		if(pressure != pressureHPa) {
+ 			pressureHPa = pressure;
+ 			updateEnvFactors();
+ 			// Rebuild the table only on a significant change (not on each hPa)
+ 			if(fabs((float)pressureHPa - lookupTablePressureHPa) > MQ131_LUT_HYSTERESIS * lookupTablePressureHPa) {
+ 				lookupTableValid = false;
+ 			}
+ 		}
  	}
- 	lastValueRs = readRs();
+ 	refreshSupply();
+ 	lastValueADC = hal->readAnalog(pinSensor);
+ 	// Select a better load resistor if needed and read again
+ 	if(autoRangeLoadResistor(lastValueADC)) {
+ 		lastValueADC = hal->readAnalog(pinSensor);
+ 	}
+ 	lastValueRs = convertToRs(lastValueADC);
+ 	lastValueFiltered = false;
+ 	if(filterWindow != NULL) {
+ 		float filtered = filterRs(lastValueRs);
+ 		if(filtered != lastValueRs) {
+ 			lastValueRs = filtered;
+ 			// The ADC code doesn't match anymore, skip the lookup table
+ 			lastValueFiltered = true;
+ 		}
+ 	}
+ 	// Only one logarithm per reading, whatever the number of getO3()
+ 	lastValueLogRs = logCurve(lastValueRs);
  	stopHeater();
+ 	if(fingerprintHistory != NULL) {
+ 		finishFingerprint();
+ 	}
+ 	return true;
+ }
+
+/**
+ * Enable the Hampel filter with a buffer for the window
+ */
+ void MQ131Class::enableFilter(float* _window, uint8_t _size, float _threshold) {
+ 	if(_size > MQ131_FILTER_MAX_WINDOW) {
+ 		_size = MQ131_FILTER_MAX_WINDOW;
+ 	}
+ 	filterWindow = _window;
+ 	filterSize = _size;
+ 	filterThreshold = _threshold;
+ 	filterCount = 0;
+ 	filterNext = 0;
+ }
+
+/**
+ * Disable the Hampel filter
+ */
+ void MQ131Class::disableFilter() {
+ 	filterWindow = NULL;
+ 	filterSize = 0;
+ 	filterCount = 0;
+ 	filterNext = 0;
+ }
+
+/**
+ * Sort a small array (insertion sort, in place)
+ */
+ static void sortValues(float* values, uint8_t count) {
+ 	for(uint8_t i = 1; i < count; i++) {
+ 		float value = values[i];
+ 		uint8_t j = i;
+ 		while(j > 0 && values[j - 1] > value) {
+ 			values[j] = values[j - 1];
+ 			j--;
+ 		}
+ 		values[j] = value;
+ 	}
+ }
+
+/**
+ * Add the reading to the window and return it, or the median of the
+ * window if the reading is an outlier
+ */
+ float MQ131Class::filterRs(float rs) {
+ 	if(filterSize == 0) {
+ 		return rs;
+ 	}
+ 	filterWindow[filterNext] = rs;
+ 	filterNext = (filterNext + 1) % filterSize;
+ 	if(filterCount < filterSize) {
+ 		filterCount++;
+ 	}
+ 	// Not enough readings to detect an outlier
+ 	if(filterCount < 3) {
+ 		return rs;
+ 	}
+
+ 	// Median of the window
+ 	float sorted[MQ131_FILTER_MAX_WINDOW];
+ 	for(uint8_t i = 0; i < filterCount; i++) {
+ 		sorted[i] = filterWindow[i];
+ 	}
+ 	sortValues(sorted, filterCount);
+ 	float median = sorted[filterCount / 2];
+
+ 	// Median absolute deviation (scaled to match the std dev for Gaussian noise)
+ 	for(uint8_t i = 0; i < filterCount; i++) {
+ 		sorted[i] = fabs(filterWindow[i] - median);
+ 	}
+ 	sortValues(sorted, filterCount);
+ 	float mad = 1.4826 * sorted[filterCount / 2];
+
+ 	// A constant window (quantized readings) has no deviation: use at least
+ 	// one ADC step at the median, dRs/dcode = (Rs + RL)^2 / (supply * RL)
+ 	float step = (median + valueRL) * (median + valueRL) / (valueSupply * valueRL);
+ 	if(mad < step) {
+ 		mad = step;
+ 	}
+
+ 	if(fabs(rs - median) > filterThreshold * mad) {
+ 		if(enableDebug) {
+ 			debugStream->print(F("MQ131 : Outlier rejected, Rs = "));
+ 			debugStream->print((uint32_t)rs);
+ 			debugStream->println(F(" Ohms"));
+ 		}
+ 		return median;
+ 	}
+ 	return rs;
+ }
+
+/**
+ * Enable the warm-up fingerprint with a buffer for the history
+ */
+ void MQ131Class::enableFingerprint(MQ131Fingerprint* _history, uint8_t _size) {
+ 	fingerprintHistory = _history;
+ 	fingerprintSize = _size;
+ 	fingerprintCount = 0;
+ 	fingerprintNext = 0;
+ }
+
+/**
+ * Disable the warm-up fingerprint
+ */
+ void MQ131Class::disableFingerprint() {
+ 	fingerprintHistory = NULL;
+ 	fingerprintSize = 0;
+ 	fingerprintCount = 0;
+ 	fingerprintNext = 0;
+ }
+
+/**
+ * Get the number of fingerprints in the history
+ */
+ uint8_t MQ131Class::getFingerprintCount() {
+ 	return fingerprintCount;
+ }
+
+/**
+ * Get a fingerprint from the history (0 = last one)
+ */
+ MQ131Fingerprint MQ131Class::getFingerprint(uint8_t age) {
+ 	MQ131Fingerprint fingerprint = {0, 0, 0};
+ 	if(age < fingerprintCount) {
+ 		fingerprint = fingerprintHistory[(fingerprintNext + fingerprintSize - 1 - age) % fingerprintSize];
+ 	}
+ 	return fingerprint;
+ }
+
+/**
+ * Read Rs once per second during the warm-up and integrate it
+ * (trapezoidal rule, no buffer)
+ */
+ void MQ131Class::updateFingerprint() {
+ 	uint32_t sec = hal->getMillis() / 1000;
+ 	if(fingerprintSamples > 0 && sec == fingerprintLastSec) {
+ 		return;
+ 	}
+ 	float rs = convertToRs(hal->readAnalog(pinSensor));
+ 	if(fingerprintSamples == 0) {
+ 		fingerprintFirstSec = sec;
+ 		fingerprintFirstRs = rs;
+ 		fingerprintIntegral = 0;
+ 	} else {
+ 		fingerprintIntegral += (rs + fingerprintLastRs) / 2.0 * (sec - fingerprintLastSec);
+ 	}
+ 	fingerprintLastSec = sec;
+ 	fingerprintLastRs = rs;
+ 	fingerprintSamples++;
+ }
+
+/**
+ * Compute the fingerprint at the time to read and store it in the history
+ */
+ void MQ131Class::finishFingerprint() {
+ 	if(fingerprintSamples == 0 || fingerprintSize == 0) {
+ 		return;
+ 	}
+ 	uint32_t sec = hal->getMillis() / 1000;
+ 	fingerprintIntegral += (lastValueRs + fingerprintLastRs) / 2.0 * (sec - fingerprintLastSec);
+
+ 	// For an exponential, the area between Rs(t) and rsEnd is (rsStart - rsEnd) * tau
+ 	MQ131Fingerprint fingerprint;
+ 	fingerprint.rsStart = fingerprintFirstRs;
+ 	fingerprint.rsEnd = lastValueRs;
+ 	fingerprint.tau = 0;
+ 	float amplitude = fingerprintFirstRs - lastValueRs;
+ 	if(fabs(amplitude) > 0.01 * lastValueRs) {
+ 		fingerprint.tau = (fingerprintIntegral - lastValueRs * (sec - fingerprintFirstSec)) / amplitude;
+ 	}
+
+ 	fingerprintHistory[fingerprintNext] = fingerprint;
+ 	fingerprintNext = (fingerprintNext + 1) % fingerprintSize;
+ 	if(fingerprintCount < fingerprintSize) {
+ 		fingerprintCount++;
+ 	}
+ 	fingerprintSamples = 0;
+
+ 	if(enableDebug) {
+ 		debugStream->print(F("MQ131 : Warm-up from "));
+ 		debugStream->print((uint32_t)fingerprint.rsStart);
+ 		debugStream->print(F(" to "));
+ 		debugStream->print((uint32_t)fingerprint.rsEnd);
+ 		debugStream->print(F(" Ohms, tau = "));
+ 		debugStream->print(fingerprint.tau);
+ 		debugStream->println(F(" s"));
+ 	}
+ }
+
+/**
+ * Get the aging indicator: largest relative drift of rsEnd and tau
+ * over the history
+ */
+ float MQ131Class::getAgingIndicator() {
+ 	float driftRs = getHistoryDrift(false);
+ 	float driftTau = getHistoryDrift(true);
+ 	return driftRs > driftTau ? driftRs : driftTau;
+ }
+
+/**
+ * Relative drift over the history (slope of the least squares line
+ * multiplied by the length of the history, divided by the mean)
+ */
+ float MQ131Class::getHistoryDrift(bool useTau) {
+ 	if(fingerprintCount < 3) {
+ 		return 0;
+ 	}
+ 	float meanX = (fingerprintCount - 1) / 2.0;
+ 	float meanY = 0;
+ 	for(uint8_t age = 0; age < fingerprintCount; age++) {
+ 		MQ131Fingerprint fingerprint = getFingerprint(age);
+ 		meanY += useTau ? fingerprint.tau : fingerprint.rsEnd;
+ 	}
+ 	meanY /= fingerprintCount;
+ 	if(meanY == 0) {
+ 		return 0;
+ 	}
+ 	float sumXY = 0;
+ 	float sumXX = 0;
+ 	for(uint8_t age = 0; age < fingerprintCount; age++) {
+ 		MQ131Fingerprint fingerprint = getFingerprint(age);
+ 		// Oldest first
+ 		float x = fingerprintCount - 1 - age - meanX;
+ 		float y = (useTau ? fingerprint.tau : fingerprint.rsEnd) - meanY;
+ 		sumXY += x * y;
+ 		sumXX += x * x;
+ 	}
+ 	return fabs(sumXY / sumXX * (fingerprintCount - 1) / meanY);
  }
 
 /**
  * Start the heater
  */
  void MQ131Class::startHeater() {
- 	digitalWrite(pinPower, HIGH);
- 	secLastStart = millis()/1000;
+ 	hal->writePin(pinPower, HIGH);
+ 	msLastStart = hal->getMillis();
+ 	secLastStart = msLastStart / 1000;
  }
 
 /**
@@ -111,11 +538,12 @@ MQ131Class::~MQ131Class() {
  */
  bool MQ131Class::isTimeToRead() {
  	// Check if the heater has been started...
- 	if(secLastStart < 0) {
+ 	if(secLastStart == (uint32_t)-1) {
  		return false;
  	}
  	// OK, check if it's the time to read based on calibration parameters
- 	if(millis() / 1000 >= secLastStart + getTimeToRead()) {
+ 	// (elapsed time in unsigned arithmetic, right across the wrap of millis())
+ 	if((hal->getMillis() - msLastStart) / 1000 >= secToRead) {
  		return true;
  	}
  	return false;
@@ -125,7 +553,7 @@ MQ131Class::~MQ131Class() {
  * Stop the heater
  */
  void MQ131Class::stopHeater() {
- 	digitalWrite(pinPower, LOW);
+ 	hal->writePin(pinPower, LOW);
  	secLastStart = -1;
  }
 
@@ -149,47 +577,294 @@ MQ131Class::~MQ131Class() {
  */
  float MQ131Class::readRs() {
  	// Read the value
- 	uint16_t valueSensor = analogRead(pinSensor);
- 	// Compute the voltage on load resistance (for 5V Arduino)
-  float vRL = ((float)valueSensor) / 1024.0 * 5.0;
- 	// Compute the resistance of the sensor (for 5V Arduino)
-  if(!vRL) return 0.0f; //division by zero prevention
- 	float rS = (5.0 / vRL - 1.0) * valueRL;
+ 	refreshSupply();
+ 	return convertToRs(hal->readAnalog(pinSensor));
+ }
+
+/**
+ * Convert the ADC code to Rs value
+ */
+ float MQ131Class::convertToRs(uint16_t valueSensor) {
+ 	// The voltage on load resistance is valueSensor (in ADC steps)
+ 	// A saturated code (0 or the supply) means Rs out of the range of the
+ 	// circuit: keep half a step from the limits so Rs stays finite and positive
+ 	float code = valueSensor;
+ 	if(code < 0.5) {
+ 		code = 0.5;
+ 	}
+ 	if(code > valueSupply - 0.5) {
+ 		code = valueSupply - 0.5;
+ 	}
+ 	// Compute the resistance of the sensor with the supply (in ADC steps)
+ 	float rS = (valueSupply / code - 1.0) * valueRL;
  	return rS;
  }
 
+/**
+ * Measure the supply of the sensor circuit on a second ADC channel
+ */
+ void MQ131Class::setSupplyPin(uint8_t _pin, float _dividerRatio, uint8_t _refreshCycles) {
+ 	pinSupply = _pin;
+ 	supplyDividerRatio = _dividerRatio;
+ 	supplySensorVolts = 0;
+ 	supplyRefreshCycles = _refreshCycles;
+ 	supplyCountdown = 0;
+ 	hal->setPinMode(pinSupply, INPUT);
+ }
+
+/**
+ * Measure the ADC reference with the internal bandgap (AVR only)
+ */
+ void MQ131Class::setSupplyBandgap(float _sensorSupplyVolts, uint8_t _refreshCycles) {
+ 	pinSupply = -1;
+ 	supplySensorVolts = _sensorSupplyVolts;
+ 	supplyRefreshCycles = _refreshCycles;
+ 	supplyCountdown = 0;
+ }
+
+/**
+ * Refresh the supply measurement every supplyRefreshCycles readings
+ * (cached in between to avoid doubling the ADC cost)
+ */
+ void MQ131Class::refreshSupply() {
+ 	if(supplyRefreshCycles == 0) {
+ 		return;
+ 	}
+ 	if(supplyCountdown > 0) {
+ 		supplyCountdown--;
+ 		return;
+ 	}
+ 	supplyCountdown = supplyRefreshCycles - 1;
+
+ 	float supply = MQ131_ADC_STEPS;
+ 	if(pinSupply != (uint8_t)-1) {
+ 		supply = hal->readAnalog(pinSupply) * supplyDividerRatio;
+ 	} else {
+ 		// Vcc = bandgap * steps / reading, so the sensor supply in ADC steps
+ 		// is Vs / Vcc * steps = Vs * reading / bandgap
+ 		uint16_t bandgap = readBandgap();
+ 		if(bandgap > 0) {
+ 			supply = supplySensorVolts * bandgap / MQ131_BANDGAP_VOLTS;
+ 		}
+ 	}
+
+ 	// A supply below one step is a wrong measurement, keep the last one
+ 	if(supply >= 1) {
+ 		valueSupply = supply;
+ 		// Rebuild the table only on a significant change (not on the noise of the ADC)
+ 		if(fabs(valueSupply - lookupTableSupply) > MQ131_LUT_HYSTERESIS * lookupTableSupply) {
+ 			lookupTableValid = false;
+ 		}
+ 	}
+ }
+
+/**
+ * Get the supply of the sensor circuit (ADC steps)
+ */
+ float MQ131Class::getSupply() {
+ 	return valueSupply;
+ }
+
+/**
+ * Read the internal bandgap against AVCC (0 if not supported)
+ */
+ uint16_t MQ131Class::readBandgap() {
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega328__) || defined(__AVR_ATmega168__)
+ 	ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+#elif defined(__AVR_ATmega32U4__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+ 	ADCSRB &= ~_BV(MUX5);
+ 	ADMUX = _BV(REFS0) | _BV(MUX4) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+#else
+ 	return 0;
+#endif
+#if defined(ADMUX)
+ 	// Let the reference settle, then convert
+ 	delay(2);
+ 	ADCSRA |= _BV(ADSC);
+ 	while(bit_is_set(ADCSRA, ADSC));
+ 	return ADC;
+#endif
+ }
+
+/**
+ * Define the switchable load resistors (up to MQ131_MAX_LOAD_RESISTORS)
+ */
+ void MQ131Class::setLoadResistors(const uint8_t* _pins, const uint32_t* _values, uint8_t _count, uint16_t _settleMs) {
+ 	if(_count > MQ131_MAX_LOAD_RESISTORS) {
+ 		_count = MQ131_MAX_LOAD_RESISTORS;
+ 	}
+ 	for(uint8_t i = 0; i < _count; i++) {
+ 		loadResistorPins[i] = _pins[i];
+ 		loadResistorValues[i] = _values[i];
+ 	}
+ 	loadResistorCount = _count;
+ 	loadResistorSettleMs = _settleMs;
+ 	if(loadResistorCount > 0) {
+ 		selectLoadResistor(0);
+ 	}
+ }
+
+/**
+ * Get the active load resistance
+ */
+ uint32_t MQ131Class::getRL() {
+ 	return valueRL;
+ }
+
+/**
+ * Get the index of the active switchable load resistor (0 without them)
+ */
+ uint8_t MQ131Class::getLoadResistorIndex() {
+ 	return loadResistorIndex;
+ }
+
+/**
+ * Connect one load resistor to GND and leave the others floating
+ */
+ void MQ131Class::selectLoadResistor(uint8_t index) {
+ 	// Disconnect first to never have two resistors in parallel
+ 	for(uint8_t i = 0; i < loadResistorCount; i++) {
+ 		if(i != index) {
+ 			hal->setPinMode(loadResistorPins[i], INPUT);
+ 		}
+ 	}
+ 	hal->setPinMode(loadResistorPins[index], OUTPUT);
+ 	hal->writePin(loadResistorPins[index], LOW);
+ 	loadResistorIndex = index;
+ 	valueRL = loadResistorValues[index];
+ 	lookupTableValid = false;
+ }
+
+/**
+ * Select the load resistor closest to Rs (voltage centered in the ADC range)
+ * Return true if the resistor has been switched
+ */
+ bool MQ131Class::autoRangeLoadResistor(uint16_t valueSensor) {
+ 	if(loadResistorCount < 2) {
+ 		return false;
+ 	}
+
+ 	// Estimate Rs with the active resistor (at the rails, assume the worst case)
+ 	float rS;
+ 	if(valueSensor == 0) {
+ 		rS = 1e12;
+ 	} else {
+ 		rS = convertToRs(valueSensor);
+ 	}
+
+ 	// Vout = Vcc * RL / (RL + Rs) is centered when RL = Rs
+ 	uint8_t best = loadResistorIndex;
+ 	float bestDistance = fabs(log(loadResistorValues[best] / rS));
+ 	for(uint8_t i = 0; i < loadResistorCount; i++) {
+ 		float distance = fabs(log(loadResistorValues[i] / rS));
+ 		if(distance < bestDistance) {
+ 			best = i;
+ 			bestDistance = distance;
+ 		}
+ 	}
+
+ 	if(best == loadResistorIndex) {
+ 		return false;
+ 	}
+
+ 	if(enableDebug) {
+ 		debugStream->print(F("MQ131 : Switch load resistance to "));
+ 		debugStream->print(loadResistorValues[best]);
+ 		debugStream->println(F(" Ohms"));
+ 	}
+
+ 	selectLoadResistor(best);
+ 	hal->wait(loadResistorSettleMs);
+ 	return true;
+ }
+
 /**
  * Set environmental values
  */
- void MQ131Class::setEnv(int8_t tempCels, uint8_t humPc) {
+ void MQ131Class::setEnv(int8_t tempCels, uint8_t humPc, uint16_t _pressureHPa) {
  	temperatureCelsuis = tempCels;
  	humidityPercent = humPc;
+ 	pressureHPa = _pressureHPa;
+ 	updateEnvFactors();
+ 	lookupTableValid = false;
+ }
+
+/**
+ * Precompute the factors depending on the environment
+ * (once per update instead of once per reading)
+ */
+ void MQ131Class::updateEnvFactors() {
+  envCorrectRatio = getEnvCorrectRatio();
+
+  // Pressure unknown (0), use the default one
+  if(pressureHPa == 0) {
+    pressureHPa = MQ131_DEFAULT_PRESSURE_HPA;
+  }
+
+  // Same ozone ratio (ppb) gives less molecules on the sensor at low pressure
+  pressureCorrection = 1.0;
+  if(enablePressureCompensation) {
+    pressureCorrection = (float)MQ131_REFERENCE_PRESSURE_HPA / pressureHPa;
+  }
+
+  // Molar volume of an ideal gas (L/mol) at the given temperature and pressure
+  float molarVolume = MQ131_GAS_CONSTANT * (temperatureCelsuis + 273.15) / pressureHPa;
+  massConcentrationFactor = MQ131_O3_MOLAR_MASS / molarVolume;
+
+  updateLogOffsets();
+ }
+
+/**
+ * Enable or disable the barometric pressure compensation
+ */
+ void MQ131Class::setPressureCompensation(bool enable) {
+ 	enablePressureCompensation = enable;
+ 	updateEnvFactors();
+ 	lookupTableValid = false;
+ }
+
+/**
+ * Define the barometer to read the pressure at each sample()
+ */
+ void MQ131Class::setBarometer(MQ131Barometer* _barometer) {
+ 	barometer = _barometer;
  }
 
 /**
- * Get correction to apply on Rs depending on environmental
- * conditions
+ * Get the environmental correction: Rs/R0 of the element in the current
+ * conditions relative to 20°C 60% (datasheet curves). The element reads a
+ * higher Rs when colder or drier, so the measured Rs/R0 is divided by it
  */
  float MQ131Class::getEnvCorrectRatio() {
- 	// Select the right equation based on humidity
- 	// If default value, ignore correction ratio
- 	if(humidityPercent == 60 && temperatureCelsuis == 20) {
- 		return 1.0;
- 	}
- 	// For humidity > 75%, use the 85% curve
- 	if(humidityPercent > 75) {
-    // R^2 = 0.996
-   	return -0.0103 * temperatureCelsuis + 1.1507;
- 	}
- 	// For humidity > 50%, use the 60% curve
- 	if(humidityPercent > 50) {
- 		// R^2 = 0.9976
- 		return -0.0119 * temperatureCelsuis + 1.3261;
+ 	// Lines of the datasheet curves at 30% (R^2 = 0.9986), 60% (R^2 = 0.9976)
+ 	// and 85% (R^2 = 0.996) of humidity
+ 	float dry = -0.0141 * temperatureCelsuis + 1.5623;
+ 	float medium = -0.0119 * temperatureCelsuis + 1.3261;
+ 	float humid = -0.0103 * temperatureCelsuis + 1.1507;
+
+ 	// Interpolate between the curves (continuous in humidity), the closest
+ 	// curve outside of their range
+ 	float ratio;
+ 	if(humidityPercent <= 30) {
+ 		ratio = dry;
+ 	} else if(humidityPercent < 60) {
+ 		ratio = dry + (medium - dry) * (humidityPercent - 30) / 30.0;
+ 	} else if(humidityPercent < 85) {
+ 		ratio = medium + (humid - medium) * (humidityPercent - 60) / 25.0;
+ 	} else {
+ 		ratio = humid;
  	}
 
- 	// Humidity < 50%, use the 30% curve
-  // R^2 = 0.9986
- 	return -0.0141 * temperatureCelsuis + 1.5623;
+ 	// The curves are not 1 at 20°C 60% (the 60% line gives 1.0881 there):
+ 	// normalize them so the correction is 1 in the reference environment
+ 	float reference = -0.0119 * 20 + 1.3261;
+ 	ratio /= reference;
+
+ 	// The lines cross 0 far above the datasheet range (no logarithm of 0)
+ 	if(ratio < MQ131_MIN_ENV_CORRECT_RATIO) {
+ 		ratio = MQ131_MIN_ENV_CORRECT_RATIO;
+ 	}
+ 	return ratio;
  }
 
  /**
@@ -201,46 +876,275 @@ MQ131Class::~MQ131Class() {
  		return 0.0;
  	}
 
-  float ratio = 0.0;
+  // Use the lookup table if enabled (rebuilt if something changed)
+  if(lookupTable != NULL && !lastValueFiltered && lastValueADC < lookupTableSize) {
+    if(!lookupTableValid) {
+      buildLookupTable();
+    }
+    uint16_t entry = lookupTable[lastValueADC];
+    if(entry != MQ131_LUT_SATURATED) {
+      return convert(decodeLookupEntry(entry), getNativeUnit(), unit);
+    }
+  }
 
- 	switch(model) {
- 		case LOW_CONCENTRATION :
- 			// Use the equation to compute the O3 concentration in ppm
-      // Compute the ratio Rs/R0 and apply the environmental correction
-      ratio = lastValueRs / valueR0 * getEnvCorrectRatio();
-      // R^2 = 0.9906
-      // Use this if you are monitoring low concentration of O3 (air quality project)
-      return convert(9.4783 * pow(ratio, 2.3348), PPB, unit);
-      
-      // R^2 = 0.9986 but nearly impossible to have 0ppb
-      // Use this if you are constantly monitoring high concentration of O3
-      // return convert((10.66435681 * pow(ratio, 2.25889394) - 10.66435681), PPB, unit);
-
- 		case HIGH_CONCENTRATION :
- 			// Use the equation to compute the O3 concentration in ppm
- 			
-      // Compute the ratio Rs/R0 and apply the environmental correction
-      ratio = lastValueRs / valueR0 * getEnvCorrectRatio();
-      // R^2 = 0.9900
-      // Use this if you are monitoring low concentration of O3 (air quality project)
-      return convert(8.1399 * pow(ratio, 2.3297), PPM, unit);
-      
-      // R^2 = 0.9985 but nearly impossible to have 0ppm
-      // Use this if you are constantly monitoring high concentration of O3
-      // return convert((8.37768358 * pow(ratio, 2.30375446) - 8.37768358), PPM, unit);
+  return computeO3FromLog(lastValueLogRs, unit);
+}
 
-    case SN_O2_LOW_CONCENTRATION:
-      // NOT TESTED BY @ostaquet (I don't have this type of sensor)
-      ratio = 12.15* lastValueRs / valueR0 * getEnvCorrectRatio();
-      // r^2 = 0.9956
-      return convert(26.941 * pow(ratio,-1.16),PPB,unit);
-      break;
-      
- 		default :
- 			return 0.0;
+ /**
+ * Get the provisional gas concentration during the warm-up
+ */
+ float MQ131Class::getProvisionalO3(MQ131Unit unit) {
+ 	// Heater not started, no meaning
+ 	if(secLastStart == (uint32_t)-1) {
+ 		return 0.0;
+ 	}
+ 	return computeO3FromLog(logCurve(convertToRs(hal->readAnalog(pinSensor))), unit);
+ }
+
+ /**
+ * Get the unit provided by the equation of the model
+ */
+ MQ131Unit MQ131Class::getNativeUnit() {
+  if(model == HIGH_CONCENTRATION) {
+    return PPM;
   }
+  return PPB;
+ }
+
+ /**
+ * Compute gas concentration for O3 in the native unit of the model
+ */
+ float MQ131Class::computeO3(float rs) {
+  return computeO3FromLog(logCurve(rs), getNativeUnit());
 }
 
+ /**
+ * Compute gas concentration for O3 from ln(Rs), in any unit
+ * a * (Rs/R0 / env)^b * pressure * unit = exp(b * ln(Rs) + offset)
+ * (one exponential whatever the unit)
+ */
+ float MQ131Class::computeO3FromLog(float logRs, MQ131Unit unit) {
+  float x = curveB * logRs + logOffset + logUnitFactor[unit];
+  // Saturate instead of overflowing to infinity (e.g. R0 far too small)
+  if(x > 88.0f) {
+    x = 88.0f;
+  }
+  return expCurve(x);
+}
+
+ /**
+ * Fold R0, the environment, the curve and the unit factors into the
+ * offsets of the log domain (once per change instead of once per reading)
+ */
+ void MQ131Class::updateLogOffsets() {
+  logOffset = log(curveA) - curveB * (log(envCorrectRatio) + log(valueR0)) + log(pressureCorrection);
+  for(uint8_t unit = PPM; unit <= UG_M3; unit++) {
+    logUnitFactor[unit] = log(convert(1.0, getNativeUnit(), (MQ131Unit)unit));
+  }
+}
+
+ /**
+ * Define the curve concentration = a * (Rs/R0)^b
+ * (concentration in the native unit of the model)
+ * Return false if the curve is not valid (the current one is kept)
+ */
+ bool MQ131Class::setCurve(float a, float b) {
+  // Not a curve (e.g. fit of degenerate points), keep the current one
+  if(!(a > 0) || isinf(a) || !(fabs(b) <= MQ131_MAX_CURVE_EXPONENT)) {
+    return false;
+  }
+  curveA = a;
+  curveB = b;
+  updateLogOffsets();
+  lookupTableValid = false;
+  return true;
+ }
+
+ /**
+ * Get the coefficient a of the curve
+ */
+ float MQ131Class::getCurveA() {
+  return curveA;
+ }
+
+ /**
+ * Get the exponent b of the curve
+ */
+ float MQ131Class::getCurveB() {
+  return curveB;
+ }
+
+ /**
+ * Get the last ADC code read by sample()
+ */
+ uint16_t MQ131Class::getRawADC() {
+  return lastValueADC;
+ }
+
+ /**
+ * Get the last Rs value read by sample()
+ */
+ float MQ131Class::getRs() {
+  return lastValueRs;
+ }
+
+ /**
+ * Forget the points of the multi-point calibration
+ */
+ void MQ131Class::resetCalibrationPoints() {
+  pointCount = 0;
+  pointSumX = 0;
+  pointSumY = 0;
+  pointSumXX = 0;
+  pointSumXY = 0;
+ }
+
+ /**
+ * Add a point (Rs, reference concentration in ppb) to the multi-point
+ * calibration. Only the sums of the least squares are kept (no buffer).
+ * Return false if the point is not usable or if there are already
+ * 65535 points
+ */
+ bool MQ131Class::addCalibrationPoint(float rs, float ppb) {
+  if(pointCount == 0xFFFF) {
+    return false;
+  }
+  float concentration = convert(ppb, PPB, getNativeUnit()) / pressureCorrection;
+  float ratio = rs / valueR0 / envCorrectRatio;
+  if(!(concentration > 0) || !(ratio > 0)) {
+    return false;
+  }
+
+  // Linear in log domain: ln(concentration) = ln(a) + b * ln(ratio)
+  float x = log(ratio);
+  float y = log(concentration);
+  pointCount++;
+  pointSumX += x;
+  pointSumY += y;
+  pointSumXX += x * x;
+  pointSumXY += x * y;
+  return true;
+ }
+
+ /**
+ * Fit the curve of the sensor on the calibration points
+ * With one point, only the coefficient a is adjusted
+ * Return false if there is not enough points or if the fit is not a
+ * valid curve
+ */
+ bool MQ131Class::solveCalibrationPoints() {
+  if(pointCount == 0) {
+    return false;
+  }
+
+  float b = curveB;
+  if(pointCount >= 2) {
+    float det = pointCount * pointSumXX - pointSumX * pointSumX;
+    // Points too close to each other to find the slope
+    if(fabs(det) < 1e-6 * pointCount * pointCount) {
+      return false;
+    }
+    b = (pointCount * pointSumXY - pointSumX * pointSumY) / det;
+  }
+  float lnA = (pointSumY - b * pointSumX) / pointCount;
+
+  if(enableDebug) {
+    debugStream->print(F("MQ131 : Curve fitted on "));
+    debugStream->print(pointCount);
+    debugStream->print(F(" points, a = "));
+    debugStream->print(exp(lnA), 4);
+    debugStream->print(F(", b = "));
+    debugStream->println(b, 4);
+  }
+
+  return setCurve(exp(lnA), b);
+ }
+
+ /**
+ * Enable the lookup table mode with a buffer provided by the caller
+ * (one entry per ADC code, 2 bytes each)
+ */
+ void MQ131Class::enableLookupTable(uint16_t* _table, uint16_t _size) {
+  lookupTable = _table;
+  lookupTableSize = _size;
+  lookupTableValid = false;
+ }
+
+ /**
+ * Disable the lookup table mode (equations computed at each reading)
+ */
+ void MQ131Class::disableLookupTable() {
+  lookupTable = NULL;
+  lookupTableSize = 0;
+  lookupTableValid = false;
+ }
+
+ /**
+ * Define the access to the pins and the clock
+ * (NULL to restore the Arduino functions)
+ */
+ void MQ131Class::setHal(MQ131Hal* _hal) {
+  hal = _hal != NULL ? _hal : &MQ131ArduinoHal;
+ }
+
+ /**
+ * Get the access to the pins and the clock
+ */
+ MQ131Hal* MQ131Class::getHal() {
+  return hal;
+ }
+
+ /**
+ * Compute the concentration for every ADC code and store it
+ * quantized in the lookup table
+ */
+ void MQ131Class::buildLookupTable() {
+  // Keep track of the quantization error for the report (every entry)
+  float maxError = 0.0;
+  uint16_t saturatedCount = 0;
+
+  for(uint16_t code = 0; code < lookupTableSize; code++) {
+    float value = computeO3(convertToRs(code));
+    // Out of range values (or not a number) are computed on the fly
+    uint16_t entry = encodeLookupEntry(value);
+    lookupTable[code] = entry;
+    if(entry == MQ131_LUT_SATURATED) {
+      saturatedCount++;
+      continue;
+    }
+    float error = fabs(decodeLookupEntry(entry) - value) / value;
+    if(error > maxError) {
+      maxError = error;
+    }
+  }
+
+  // Above the bound, the table is not used (every code computed on the fly)
+  bool rejected = maxError > MQ131_LUT_MAX_ERROR;
+  if(rejected) {
+    for(uint16_t code = 0; code < lookupTableSize; code++) {
+      lookupTable[code] = MQ131_LUT_SATURATED;
+    }
+  }
+  lookupTableValid = true;
+  lookupTableSupply = valueSupply;
+  lookupTablePressureHPa = pressureHPa;
+
+  if(enableDebug) {
+    debugStream->print(F("MQ131 : Lookup table of "));
+    debugStream->print(lookupTableSize);
+    debugStream->print(F(" entries ("));
+    debugStream->print((uint32_t)lookupTableSize * sizeof(uint16_t));
+    debugStream->print(F(" bytes), max quantization error "));
+    debugStream->print(maxError * 100.0, 3);
+    debugStream->print(F(" %, "));
+    debugStream->print(saturatedCount);
+    debugStream->println(F(" entries out of range"));
+    if(rejected) {
+      debugStream->println(F("MQ131 : Quantization error above MQ131_LUT_MAX_ERROR, table not used"));
+    }
+  }
+ }
+
  /**
   * Convert gas unit of gas concentration
   */
@@ -268,14 +1172,14 @@ MQ131Class::~MQ131Class() {
       } else {
         concentration = input / 1000.0;
       }
-      return concentration * 48.0 / 22.71108;
+      return concentration * massConcentrationFactor;
     case UG_M3 :
       if(unitIn == PPB) {
         concentration = input;
       } else {
         concentration = input * 1000.0;
       }
-      return concentration * 48.0 / 22.71108;
+      return concentration * massConcentrationFactor;
     default :
       return input;
   }
@@ -285,14 +1189,62 @@ MQ131Class::~MQ131Class() {
   * Calibrate the basic values (R0 and time to read)
   */
 void MQ131Class::calibrate() {
+  startCalibration();
+  while(!updateCalibration()) {
+    hal->wait(1000);
+  }
+}
+
+ /**
+  * Restart running statistics
+  */
+static void resetRunningStats(MQ131RunningStats& stats) {
+  stats.count = 0;
+  stats.meanT = 0;
+  stats.meanRs = 0;
+  stats.m2T = 0;
+  stats.m2Rs = 0;
+  stats.coMoment = 0;
+  stats.minRs = 0;
+  stats.maxRs = 0;
+}
+
+ /**
+  * Add one reading to running statistics (Welford)
+  */
+static void addRunningStats(MQ131RunningStats& stats, float value) {
+  float t = stats.count;
+  stats.count++;
+  float deltaT = t - stats.meanT;
+  stats.meanT += deltaT / stats.count;
+  float deltaRs = value - stats.meanRs;
+  stats.meanRs += deltaRs / stats.count;
+  stats.m2T += deltaT * (t - stats.meanT);
+  stats.m2Rs += deltaRs * (value - stats.meanRs);
+  stats.coMoment += deltaT * (value - stats.meanRs);
+  if(stats.count == 1 || value < stats.minRs) {
+    stats.minRs = value;
+  }
+  if(stats.count == 1 || value > stats.maxRs) {
+    stats.maxRs = value;
+  }
+}
+
+ /**
+  * Start the calibration without blocking (heater on)
+  */
+void MQ131Class::startCalibration() {
   // Take care of the last Rs value read on the sensor
   // (forget the decimals)
-  float lastRsValue = 0;
-  float lastLastRsValue = 0;
+  calibLastRsValue = 0;
+  calibLastLastRsValue = 0;
   // Count how many time we keep the same Rs value in a row
-  uint8_t countReadInRow = 0;
+  calibCountReadInRow = 0;
   // Count how long we have to wait to have consistent value
-  uint8_t count = 0;
+  calibCount = 0;
+  resetRunningStats(calibWindow);
+  resetRunningStats(calibTail);
+  calibTimedOut = false;
 
   // Get some info
   if(enableDebug) {
@@ -301,53 +1253,137 @@ void MQ131Class::calibrate() {
     debugStream->print(F("MQ131 : Stable cycles required : "));
     debugStream->print(MQ131_DEFAULT_STABLE_CYCLE);
     debugStream->println(F(" (compilation parameter MQ131_DEFAULT_STABLE_CYCLE)"));
+    debugStream->print(F("MQ131 : Timeout : "));
+    debugStream->print(MQ131_DEFAULT_CALIBRATION_TIMEOUT);
+    debugStream->println(F(" seconds (compilation parameter MQ131_DEFAULT_CALIBRATION_TIMEOUT)"));
   }
 
   // Start heater
   startHeater();
+}
 
-  uint8_t timeToReadConsistency = MQ131_DEFAULT_STABLE_CYCLE;
+ /**
+  * Continue the calibration started with startCalibration()
+  * Should be called every second (one reading per call)
+  * Return true when the calibration is done (heater stopped)
+  */
+bool MQ131Class::updateCalibration() {
+  float value = readRs();
 
-  while(countReadInRow <= timeToReadConsistency) {
-    float value = readRs();
+  if(enableDebug) {
+    debugStream->print(F("MQ131 : Rs read = "));
+    debugStream->print((uint32_t)value);
+    debugStream->println(F(" Ohms"));
+  }
+  
+  if((uint32_t)calibLastRsValue != (uint32_t)value && (uint32_t)calibLastLastRsValue != (uint32_t)value) {
+    calibLastLastRsValue = calibLastRsValue;
+    calibLastRsValue = value;
+    calibCountReadInRow = 0;
+    // New candidate for R0, restart the stable window
+    resetRunningStats(calibWindow);
+  } else {
+    calibCountReadInRow++;
+  }
+  // The tail covers the last readings before the timeout
+  if(calibCount == MQ131_DEFAULT_CALIBRATION_TIMEOUT - MQ131_CALIBRATION_TAIL) {
+    resetRunningStats(calibTail);
+  }
+  calibCount++;
 
-    if(enableDebug) {
-      debugStream->print(F("MQ131 : Rs read = "));
-      debugStream->print((uint32_t)value);
-      debugStream->println(F(" Ohms"));
-    }
-    
-    if((uint32_t)lastRsValue != (uint32_t)value && (uint32_t)lastLastRsValue != (uint32_t)value) {
-      lastLastRsValue = lastRsValue;
-      lastRsValue = value;
-      countReadInRow = 0;
-    } else {
-      countReadInRow++;
+  // Update the running statistics
+  addRunningStats(calibWindow, value);
+  addRunningStats(calibTail, value);
+
+  uint16_t timeToReadConsistency = MQ131_DEFAULT_STABLE_CYCLE;
+  if(calibCountReadInRow <= timeToReadConsistency) {
+    // Never stable (noise above the resolution), give up after the timeout
+    if(calibCount < MQ131_DEFAULT_CALIBRATION_TIMEOUT) {
+      return false;
     }
-    count++;
-    delay(1000);
+    calibTimedOut = true;
   }
 
   if(enableDebug) {
-    debugStream->print(F("MQ131 : Stabilisation after "));
-    debugStream->print(count);
+    if(calibTimedOut) {
+      debugStream->print(F("MQ131 : No stabilisation after "));
+    } else {
+      debugStream->print(F("MQ131 : Stabilisation after "));
+    }
+    debugStream->print(calibCount);
     debugStream->println(F(" seconds"));
     debugStream->println(F("MQ131 : Stop heater and store calibration parameters"));
   }
 
+  if(enableDebug) {
+    MQ131CalibrationStats stats = getCalibrationStats();
+    debugStream->print(F("MQ131 : Stable window of "));
+    debugStream->print(stats.stableSamples);
+    debugStream->print(F(" readings, std dev = "));
+    debugStream->print(stats.stdDevRs);
+    debugStream->print(F(" Ohms, slope = "));
+    debugStream->print(stats.slopeRs);
+    debugStream->println(F(" Ohms/s"));
+  }
+
   // Stop heater
   stopHeater();
 
+  // Timeout: R0 from the mean of the tail (the window since the last
+  // change holds only a few readings), the time to read is unknown (keep
+  // the previous one)
+  if(calibTimedOut) {
+    setR0(calibTail.meanRs);
+    return true;
+  }
+
   // We have our R0 and our time to read
-  setR0(lastRsValue);
-  setTimeToRead(count);
+  setR0(calibLastRsValue);
+  setTimeToRead(calibCount);
+  return true;
+}
+
+ /**
+  * Get the statistics of the last calibration (over the tail on timeout)
+  */
+MQ131CalibrationStats MQ131Class::getCalibrationStats() {
+  const MQ131RunningStats& window = calibTimedOut ? calibTail : calibWindow;
+  // R0 of the calibration
+  float reference = calibTimedOut ? calibTail.meanRs : calibLastRsValue;
+  MQ131CalibrationStats stats;
+  stats.samples = calibCount;
+  stats.stableSamples = window.count;
+  stats.meanRs = window.meanRs;
+  stats.stdDevRs = 0;
+  stats.slopeRs = 0;
+  stats.maxDeviation = 0;
+  stats.timedOut = calibTimedOut;
+  if(window.count > 1) {
+    stats.stdDevRs = sqrt(window.m2Rs / (window.count - 1));
+    // One reading per second
+    stats.slopeRs = window.coMoment / window.m2T;
+  }
+  if(reference > 0) {
+    float deviation = fabs(window.maxRs - reference);
+    if(fabs(reference - window.minRs) > deviation) {
+      deviation = fabs(reference - window.minRs);
+    }
+    stats.maxDeviation = deviation / reference;
+  }
+  return stats;
 }
 
  /**
   * Store R0 value (come from calibration or set by user)
   */
   void MQ131Class::setR0(float _valueR0) {
+  	// R0 is a resistance, ignore values that would break the logarithm
+  	if(!(_valueR0 > 0) || isinf(_valueR0)) {
+  		return;
+  	}
   	valueR0 = _valueR0;
+  	updateLogOffsets();
+  	lookupTableValid = false;
   }
 
  /**
@@ -37,16 +37,124 @@
 #define MQ131_DEFAULT_RL                            1000000           // Default load resistance of 1MOhms
 #define MQ131_DEFAULT_STABLE_CYCLE                  15                // Number of cycles with low deviation to consider
                                                                       // the calibration as stable and reliable
+#ifndef MQ131_DEFAULT_CALIBRATION_TIMEOUT
+#define MQ131_DEFAULT_CALIBRATION_TIMEOUT           3600              // Max duration of the calibration (s), R0 taken from the
+                                                                      // last readings if Rs is never stable (noisy sensor)
+#endif
+#define MQ131_CALIBRATION_TAIL                      (MQ131_DEFAULT_CALIBRATION_TIMEOUT / 2)
+                                                                      // Last readings of a calibration that times out, R0 and
+                                                                      // statistics taken from them (after the warm-up)
 #define MQ131_DEFAULT_TEMPERATURE_CELSIUS           20                // Default temperature to correct environmental drift
 #define MQ131_DEFAULT_HUMIDITY_PERCENT              65                // Default humidity to correct environmental drift
+#define MQ131_DEFAULT_PRESSURE_HPA                  1013              // Default atmospheric pressure (hPa) for mass concentration
+#define MQ131_REFERENCE_PRESSURE_HPA                1013              // Pressure of the datasheet curves (hPa) for pressure compensation
+#define MQ131_MIN_ENV_CORRECT_RATIO                 0.1               // Floor of the environmental correction (lines cross 0 above 110°C)
 #define MQ131_DEFAULT_LO_CONCENTRATION_R0           1917.22           // Default R0 for low concentration MQ131
 #define MQ131_DEFAULT_LO_CONCENTRATION_TIME2READ    80                // Default time to read before stable signal for low concentration MQ131
 #define MQ131_DEFAULT_HI_CONCENTRATION_R0           235.00            // Default R0 for high concentration MQ131
 #define MQ131_DEFAULT_HI_CONCENTRATION_TIME2READ    80                // Default time to read before stable signal for high concentration MQ131
 
+// Curve of the sensor
+#define MQ131_MAX_CURVE_EXPONENT                    10.0              // Max |b| accepted by setCurve() (datasheet curves about 1 to 2.4)
+
+// Conversion to mass concentration
+#define MQ131_O3_MOLAR_MASS                         48.0              // Molar mass of O3 (g/mol)
+#define MQ131_GAS_CONSTANT                          83.14462618       // Ideal gas constant (hPa.L/(mol.K))
+
+// Analog to digital converter
+#ifndef MQ131_ADC_STEPS
+#define MQ131_ADC_STEPS                             1024              // Number of ADC codes (1024 for 10-bit, 4096 for 12-bit boards)
+#endif
+
+// Supply measurement (optional)
+#define MQ131_DEFAULT_SUPPLY_REFRESH                10                // Number of readings between two supply measurements
+#define MQ131_BANDGAP_VOLTS                         1.1               // Internal bandgap reference of AVR
+
+// Switchable load resistors (optional auto-ranging)
+#define MQ131_MAX_LOAD_RESISTORS                    4                 // Max number of GPIO switched load resistors
+#define MQ131_DEFAULT_RL_SETTLE_MS                  50                // Delay after switching the load resistor (ms)
+
+// Outlier rejection (optional Hampel filter on Rs)
+#define MQ131_FILTER_MAX_WINDOW                     15                // Max number of readings in the window
+#define MQ131_DEFAULT_FILTER_THRESHOLD              3.0               // Outlier if further than 3 (scaled) MAD from the median
+
+// Logarithm and exponential of the curve (compile time option)
+// 0 = log()/exp() of the C library, 1 = polynomial approximation within
+// about 1%, 2 = polynomial approximation within about 0.1% (for |b| up to 2.4)
+#ifndef MQ131_POW_PRECISION
+#define MQ131_POW_PRECISION                         0
+#endif
+
+// Lookup table (optional mode to map ADC code directly to concentration)
+#define MQ131_LUT_MANTISSA_BITS                     11                // Entries are small floats (native unit): 11 bits of mantissa,
+#define MQ131_LUT_EXPONENT_BIAS                     16                // 5 bits of exponent from 2^-16 to 2^15 (relative step 0.05%)
+#define MQ131_LUT_SATURATED                         0xFFFF            // Entry out of range, computed on the fly
+#define MQ131_LUT_MAX_ERROR                         0.001             // Max relative quantization error of the table, computed on
+                                                                      // the fly above it
+#define MQ131_LUT_HYSTERESIS                        0.005             // Relative change of the measured supply or pressure before
+                                                                      // the table is rebuilt (noise of the supply ADC, barometer)
+
 enum MQ131Model {LOW_CONCENTRATION, HIGH_CONCENTRATION,SN_O2_LOW_CONCENTRATION};
 enum MQ131Unit {PPM, PPB, MG_M3, UG_M3};
 
+// Quality of the last calibration
+// The stable window starts at the last change of R0 during the calibration
+// (on timeout, it is the tail of the calibration: MQ131_CALIBRATION_TAIL)
+struct MQ131CalibrationStats {
+	uint16_t samples;          // Number of readings during the calibration
+	uint16_t stableSamples;    // Number of readings in the stable window
+	float meanRs;              // Mean of Rs over the stable window (Ohms)
+	float stdDevRs;            // Standard deviation of Rs over the stable window (Ohms)
+	float slopeRs;             // Drift of Rs over the stable window (Ohms/s)
+	float maxDeviation;        // Max relative deviation from R0 over the stable window
+	bool timedOut;             // Stopped by MQ131_DEFAULT_CALIBRATION_TIMEOUT (Rs never stable)
+};
+
+// Running statistics of Rs over a window of the calibration
+// (Welford, O(1) memory, one reading per second)
+struct MQ131RunningStats {
+	uint16_t count;            // Number of readings
+	float meanT;               // Mean of the time (s from the start of the window)
+	float meanRs;              // Mean of Rs (Ohms)
+	float m2T;                 // Sum of the squared deviations of the time
+	float m2Rs;                // Sum of the squared deviations of Rs
+	float coMoment;            // Sum of the products of the deviations (time and Rs)
+	float minRs;               // Min of Rs (Ohms)
+	float maxRs;               // Max of Rs (Ohms)
+};
+
+// Fingerprint of a warm-up transient
+// Rs(t) is approximated by rsEnd + (rsStart - rsEnd) * exp(-t / tau)
+struct MQ131Fingerprint {
+	float rsStart;             // Rs at the first reading after heater start (Ohms)
+	float rsEnd;               // Rs at the time to read (Ohms)
+	float tau;                 // Time constant of the transient (s)
+};
+
+// Interface to provide the atmospheric pressure to the driver
+// (implement it on top of your barometer library, e.g. BMP280)
+class MQ131Barometer {
+	public:
+		virtual ~MQ131Barometer() {}
+
+		// Return the atmospheric pressure in hPa
+		virtual uint16_t getPressureHPa() = 0;
+};
+
+// Interface to the hardware (pins and clock) used by the driver
+// The default implementation calls the Arduino functions; replace it to
+// run the driver on virtual hardware (e.g. a simulator with its own clock)
+class MQ131Hal {
+	public:
+		virtual ~MQ131Hal() {}
+
+		virtual void setPinMode(uint8_t pin, uint8_t mode);
+		virtual void writePin(uint8_t pin, uint8_t value);
+		virtual uint16_t readAnalog(uint8_t pin);
+		virtual uint32_t getMillis();
+		virtual void wait(uint32_t ms);
+};
+
 class MQ131Class {
 	public:
     // Constructor
@@ -60,14 +168,58 @@ class MQ131Class {
 		// the main loop (delay() function included)
 		void sample();								
 
+		// Manage a full cycle without blocking the main loop
+		// Start the heater with startSample(), then call updateSample() regularly;
+		// it returns true when the value has been read (heater stopped)
+		void startSample();
+		bool updateSample();
+
+		// Outlier rejection (optional)
+		// Provide a buffer for the window of the last Rs readings (odd size,
+		// up to MQ131_FILTER_MAX_WINDOW). A reading further than threshold
+		// times the median absolute deviation from the median of the window
+		// is replaced by the median (Hampel filter); the deviation is at least
+		// one ADC step (a quantized window is often constant)
+		void enableFilter(float* _window, uint8_t _size, float _threshold = MQ131_DEFAULT_FILTER_THRESHOLD);
+		void disableFilter();
+
+		// Warm-up fingerprint (optional)
+		// Provide a buffer for the history of fingerprints; each sample() then
+		// reads Rs every second during the warm-up to fit the transient
+		// The aging indicator is the relative drift of the fingerprints over
+		// the history (e.g. 0.2 = 20%), 0 if not enough fingerprints
+		void enableFingerprint(MQ131Fingerprint* _history, uint8_t _size);
+		void disableFingerprint();
+		uint8_t getFingerprintCount();
+		MQ131Fingerprint getFingerprint(uint8_t age);
+		float getAgingIndicator();
+
 		// Read the concentration of gas
 		// The environment should be set for accurate results
 		float getO3(MQ131Unit unit);
 
+		// Last raw values read by sample() (Rs in Ohms and ADC code)
+		float getRs();
+		uint16_t getRawADC();
+
+		// Read the provisional concentration of gas during the warm-up
+		// (between startSample() and the end of updateSample(), not stored)
+		float getProvisionalO3(MQ131Unit unit);
+
 		// Define environment
 		// Define the temperature (in Celsius) and humidity (in %) to adjust the
 		// output values based on typical characteristics of the MQ131
-		void setEnv(int8_t tempCels, uint8_t humPc);
+		// The pressure (in hPa) and the temperature are also used to convert
+		// to mass concentration (mg/m3 and ug/m3), a pressure of 0 is replaced
+		// by the default pressure
+		void setEnv(int8_t tempCels, uint8_t humPc, uint16_t pressureHPa = MQ131_DEFAULT_PRESSURE_HPA);
+
+		// Barometric pressure compensation (optional)
+		// The response of the sensor depends on the number of molecules, so
+		// the concentration is corrected by the ratio with the reference pressure
+		// The barometer (if any) is read once per sample() to update the pressure
+		void setPressureCompensation(bool enable);
+		void setBarometer(MQ131Barometer* _barometer);
 
 		// Setup calibration: Time to read
 		// Define the time to read after started the heater
@@ -80,6 +232,7 @@ class MQ131Class {
 		// Define the R0 for the calibration
 		// Get function also available to know the value after calibrate()
 		// (the time to read is calculated automatically after calibration)
+		// R0 must be positive and finite, other values are ignored
 		void setR0(float _valueR0);
 		float getR0();
 
@@ -88,6 +241,83 @@ class MQ131Class {
 		// For further use of calibration values, please use getTimeToRead() and getR0()
 		void calibrate();
 
+		// Manage the calibration without blocking the main loop
+		// Start with startCalibration(), then call updateCalibration() every
+		// second; it returns true when R0 and the time to read are stored
+		// After MQ131_DEFAULT_CALIBRATION_TIMEOUT seconds without a stable Rs,
+		// the calibration stops with R0 from the last readings and keeps the
+		// previous time to read (see timedOut in the statistics)
+		void startCalibration();
+		bool updateCalibration();
+
+		// Quality of the last calibration (to reject noisy sensors)
+		MQ131CalibrationStats getCalibrationStats();
+
+		// Curve of the sensor: concentration = a * (Rs/R0)^b
+		// (in ppb for low concentration, in ppm for high concentration)
+		// Defined by default for each model, can be recalled after a
+		// multi-point calibration
+		// a must be positive and finite, |b| up to MQ131_MAX_CURVE_EXPONENT,
+		// other values are ignored (return false)
+		bool setCurve(float a, float b);
+		float getCurveA();
+		float getCurveB();
+
+		// Multi-point calibration (optional)
+		// During co-location with a reference analyzer, add the pairs of Rs
+		// (getRs() after sample()) and reference concentration in ppb, then
+		// solve to fit the curve of this sensor (least squares in log domain)
+		// The environment should be set for each point as for getO3()
+		// Up to 65535 points; solving returns false if the fit is not a
+		// valid curve (the current curve is kept)
+		void resetCalibrationPoints();
+		bool addCalibrationPoint(float rs, float ppb);
+		bool solveCalibrationPoints();
+
+		// Switchable load resistors (optional)
+		// Each resistor is wired between the sensor output and a GPIO: the active
+		// one is pulled to GND (OUTPUT LOW), the others are left floating (INPUT)
+		// At each reading, the driver selects the resistor that centers the
+		// voltage in the ADC range and converts with the active resistance
+		// Can be called before or after begin() (begin() keeps the active
+		// resistor instead of the load resistance given to it)
+		void setLoadResistors(const uint8_t* _pins, const uint32_t* _values, uint8_t _count,
+		                      uint16_t _settleMs = MQ131_DEFAULT_RL_SETTLE_MS);
+		uint32_t getRL();
+		uint8_t getLoadResistorIndex();
+
+		// Supply measurement (optional)
+		// By default, the sensor circuit is supposed to be powered by the ADC
+		// reference (e.g. 5V and AVCC), so Rs does not depend on the supply.
+		// If the sensor circuit has its own supply, measure it on a second ADC
+		// channel (through a divider, e.g. 2.0 for two equal resistors)
+		void setSupplyPin(uint8_t _pin, float _dividerRatio, uint8_t _refreshCycles = MQ131_DEFAULT_SUPPLY_REFRESH);
+		// If the sensor circuit has a regulated supply but the ADC reference (Vcc)
+		// varies, measure Vcc with the internal bandgap (AVR only)
+		void setSupplyBandgap(float _sensorSupplyVolts, uint8_t _refreshCycles = MQ131_DEFAULT_SUPPLY_REFRESH);
+		// Supply of the sensor circuit used by the last reading, in ADC steps
+		// (MQ131_ADC_STEPS without supply measurement)
+		float getSupply();
+
+		// Convert gas unit of gas concentration
+		// (mass concentration depends on the environment defined by setEnv())
+		float convert(float input, MQ131Unit unitIn, MQ131Unit unitOut);
+
+		// Lookup table mode (optional)
+		// Provide a buffer of MQ131_ADC_STEPS entries (2 bytes each) to turn
+		// each reading into a single table lookup. The table is rebuilt lazily
+		// when R0, the environment or the load resistance changes. Entries are
+		// small floats (relative error within MQ131_LUT_MAX_ERROR whatever the
+		// model and the range), out of range codes are computed on the fly
+		void enableLookupTable(uint16_t* _table, uint16_t _size);
+		void disableLookupTable();
+
+		// Hardware access (optional)
+		// Define the pins and clock used by the driver (NULL to restore the
+		// Arduino functions), call it before begin()
+		void setHal(MQ131Hal* _hal);
+		MQ131Hal* getHal();
+
 	private:
     		// Internal helpers
 		// Internal function to manage the heater
@@ -97,39 +327,157 @@ class MQ131Class {
 
 		// Internal reading function of Rs
 		float readRs();
+		float convertToRs(uint16_t valueSensor);
+
+		// Compute the concentration in the native unit of the model
+		// (PPB for low concentration, PPM for high concentration)
+		float computeO3(float rs);
+		MQ131Unit getNativeUnit();
+
+		// Compute the concentration in the log domain (from ln(Rs))
+		float computeO3FromLog(float logRs, MQ131Unit unit);
+		void updateLogOffsets();
+
+		// Measure the supply of the sensor circuit (if needed)
+		void refreshSupply();
+		uint16_t readBandgap();
+
+		// Manage the switchable load resistors
+		void selectLoadResistor(uint8_t index);
+		bool autoRangeLoadResistor(uint16_t valueSensor);
+
+		// Apply the Hampel filter on the last Rs reading
+		float filterRs(float rs);
 
-		// Get environmental correction to apply on ration Rs/R0
+		// Fit the warm-up transient incrementally
+		void updateFingerprint();
+		void finishFingerprint();
+		float getHistoryDrift(bool useTau);
+
+		// Fill the lookup table for every ADC code
+		void buildLookupTable();
+
+		// Get environmental correction (Rs/R0 is divided by it, 1 at 20°C 60%)
 		float getEnvCorrectRatio();
 
-    		// Convert gas unit of gas concentration
-    		float convert(float input, MQ131Unit unitIn, MQ131Unit unitOut);
+		// Precompute the factors depending on the environment
+		void updateEnvFactors();
 
     		// Internal variables
 		// Model of MQ131
-		MQ131Model model;
+		MQ131Model model = LOW_CONCENTRATION;
 
     		// Serial console for the debug
     		Stream* debugStream = NULL;
     		bool enableDebug = false;
 
+		// Access to the pins and the clock
+		MQ131Hal* hal = NULL;
+
 		// Details about the circuit: pins and load resistance value
 		uint8_t pinPower = -1;
 		uint8_t pinSensor = -1;
 		uint32_t valueRL = -1;
 
+		// Supply of the sensor circuit expressed in ADC steps
+		// (MQ131_ADC_STEPS when the sensor is powered by the ADC reference)
+		float valueSupply = MQ131_ADC_STEPS;
+		uint8_t pinSupply = -1;
+		float supplyDividerRatio = 1.0;
+		float supplySensorVolts = 0;
+		uint8_t supplyRefreshCycles = 0;
+		uint8_t supplyCountdown = 0;
+
+		// Switchable load resistors (auto-ranging)
+		uint8_t loadResistorPins[MQ131_MAX_LOAD_RESISTORS];
+		uint32_t loadResistorValues[MQ131_MAX_LOAD_RESISTORS];
+		uint8_t loadResistorCount = 0;
+		uint8_t loadResistorIndex = 0;
+		uint16_t loadResistorSettleMs = MQ131_DEFAULT_RL_SETTLE_MS;
+
 		// Timer to keep track of the pre-heating
 		uint32_t secLastStart = -1;
+		uint32_t msLastStart = 0;
 		uint32_t secToRead = -1;
 
 		// Calibration of R0
 		float valueR0 = -1;
 
-		// Last value for sensor resistance
+		// State of the calibration in progress
+		float calibLastRsValue = 0;
+		float calibLastLastRsValue = 0;
+		uint16_t calibCountReadInRow = 0;
+		uint16_t calibCount = 0;
+		bool calibTimedOut = false;
+
+		// Running statistics over the stable window and over the tail of
+		// the calibration (R0 on timeout, when the window is too short)
+		MQ131RunningStats calibWindow = {};
+		MQ131RunningStats calibTail = {};
+
+		// Curve of the sensor
+		float curveA = 0;
+		float curveB = 1;
+
+		// Sums of the least squares for multi-point calibration
+		uint16_t pointCount = 0;
+		float pointSumX = 0;
+		float pointSumY = 0;
+		float pointSumXX = 0;
+		float pointSumXY = 0;
+
+		// Last value for sensor resistance (and its logarithm, raw ADC code)
 		float lastValueRs = -1;
+		float lastValueLogRs = 0;
+		uint16_t lastValueADC = 0;
+		bool lastValueFiltered = false;
+
+		// Window of the Hampel filter (ring buffer)
+		float* filterWindow = NULL;
+		uint8_t filterSize = 0;
+		uint8_t filterCount = 0;
+		uint8_t filterNext = 0;
+		float filterThreshold = MQ131_DEFAULT_FILTER_THRESHOLD;
+
+		// Warm-up fingerprint in progress and history (ring buffer)
+		MQ131Fingerprint* fingerprintHistory = NULL;
+		uint8_t fingerprintSize = 0;
+		uint8_t fingerprintCount = 0;
+		uint8_t fingerprintNext = 0;
+		uint16_t fingerprintSamples = 0;
+		uint32_t fingerprintFirstSec = 0;
+		uint32_t fingerprintLastSec = 0;
+		float fingerprintFirstRs = 0;
+		float fingerprintLastRs = 0;
+		float fingerprintIntegral = 0;
+
+		// Lookup table from ADC code to concentration
+		uint16_t* lookupTable = NULL;
+		uint16_t lookupTableSize = 0;
+		bool lookupTableValid = false;
+		float lookupTableSupply = 0;
+		uint16_t lookupTablePressureHPa = 0;
 
 		// Parameters for environment
 		int8_t temperatureCelsuis = MQ131_DEFAULT_TEMPERATURE_CELSIUS;
 		uint8_t humidityPercent = MQ131_DEFAULT_HUMIDITY_PERCENT;
+		uint16_t pressureHPa = MQ131_DEFAULT_PRESSURE_HPA;
+
+		// Pressure compensation and barometer
+		bool enablePressureCompensation = false;
+		MQ131Barometer* barometer = NULL;
+
+		// Precomputed environmental factors
+		// Correction of the ratio Rs/R0 (temperature and humidity)
+		float envCorrectRatio = 1.0;
+		// Correction of the concentration (pressure)
+		float pressureCorrection = 1.0;
+		// Conversion factor from ppb to ug/m3 (or ppm to mg/m3)
+		float massConcentrationFactor = 0;
+		// Log domain: ln(a) + b * (ln(env) - ln(R0)) + ln(pressure) and
+		// ln of the factor from the native unit to each unit
+		float logOffset = 0;
+		float logUnitFactor[UG_M3 + 1] = {0, 0, 0, 0};
 };
 
 extern MQ131Class MQ131;
@@ -0,0 +1,224 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#include "MQ131Alarm.h"
+
+/**
+ * Constructor, nothing special to do
+ */
+MQ131AlarmClass::MQ131AlarmClass() {
+}
+
+/**
+ * Destructor, nothing special to do
+ */
+MQ131AlarmClass::~MQ131AlarmClass() {
+}
+
+/**
+ * Add an alarm level
+ */
+bool MQ131AlarmClass::addLevel(float threshold, float _hysteresis) {
+  if(levelCount >= MQ131_ALARM_MAX_LEVELS) {
+    return false;
+  }
+  if(levelCount > 0 && threshold <= thresholds[levelCount - 1]) {
+    return false;
+  }
+  thresholds[levelCount] = threshold;
+  hysteresis[levelCount] = _hysteresis;
+  levelCount++;
+  return true;
+}
+
+/**
+ * Define the function called when the alarm level changes
+ */
+void MQ131AlarmClass::setCallback(MQ131AlarmCallback _callback) {
+  callback = _callback;
+}
+
+/**
+ * Compute the new level from the concentration and the current level
+ * (a raised level is kept until the concentration goes below
+ * threshold - hysteresis)
+ */
+uint8_t MQ131AlarmClass::evaluate(float ppb, uint8_t current) {
+  uint8_t result = 0;
+  for(uint8_t i = 0; i < levelCount; i++) {
+    float threshold = thresholds[i];
+    if(i < current) {
+      threshold -= hysteresis[i];
+    }
+    if(ppb >= threshold) {
+      result = i + 1;
+    }
+  }
+  return result;
+}
+
+/**
+ * Call the callback if any
+ */
+void MQ131AlarmClass::notify(uint8_t _level, bool early) {
+  if(callback != NULL) {
+    callback(_level, early);
+  }
+}
+
+/**
+ * Evaluate a final reading
+ */
+uint8_t MQ131AlarmClass::update(float ppb) {
+  uint8_t newLevel = evaluate(ppb, level);
+  // The early warning is confirmed (or not) by the final reading, notify
+  // the cancellation even if the level is unchanged
+  bool cancelled = earlyLevel > newLevel;
+  earlyLevel = 0;
+  monotonicReadings = 0;
+  trendSum = 0;
+  trendCount = 0;
+  trendBlocks = 0;
+  trendEstimate = -1;
+  lastTrendEstimate = -1;
+  if(newLevel != level || cancelled) {
+    level = newLevel;
+    notify(level, false);
+  }
+  return level;
+}
+
+/**
+ * Evaluate a provisional reading during the warm-up
+ */
+uint8_t MQ131AlarmClass::updateProvisional(float ppb, bool falling) {
+  // No reading (heater not started) or out of range
+  if(!(ppb > 0) || isinf(ppb)) {
+    return earlyLevel;
+  }
+
+  // Run of readings moving towards the final one (equal readings, from the
+  // quantization of the ADC, don't break it)
+  bool towards = falling ? ppb <= lastProvisional : ppb >= lastProvisional;
+  if(monotonicReadings > 0 && !towards) {
+    monotonicReadings = 0;
+  }
+  if(monotonicReadings < 0xFF) {
+    monotonicReadings++;
+  }
+  lastProvisional = ppb;
+
+  // Trend: mean of ln(ppb) per block (averages the noise and the steps of
+  // the ADC), the last three blocks are kept
+  trendSum += log(ppb);
+  trendCount++;
+  if(trendCount >= MQ131_ALARM_TREND_READINGS) {
+    trendMeans[0] = trendMeans[1];
+    trendMeans[1] = trendMeans[2];
+    trendMeans[2] = trendSum / trendCount;
+    trendSum = 0;
+    trendCount = 0;
+    if(trendBlocks < 3) {
+      trendBlocks++;
+    }
+    // The means of consecutive blocks of an exponential transient form a
+    // geometric sequence: extrapolate its limit (Aitken) when the blocks
+    // move towards the final reading and slow down
+    lastTrendEstimate = trendEstimate;
+    trendEstimate = -1;
+    if(trendBlocks >= 3) {
+      float direction = falling ? -1.0 : 1.0;
+      float d1 = direction * (trendMeans[1] - trendMeans[0]);
+      float d2 = direction * (trendMeans[2] - trendMeans[1]);
+      if(d1 > 0 && d2 >= 0 && d2 < d1) {
+        trendEstimate = exp(trendMeans[2] + direction * d2 * d2 / (d1 - d2));
+      }
+    }
+  }
+
+  // Estimate of the final reading (negative if none)
+  float estimate = -1;
+  if(!falling) {
+    // Lower bounds: the last reading of a non-decreasing run, the trend
+    if(monotonicReadings >= MQ131_ALARM_EARLY_READINGS) {
+      estimate = ppb;
+    }
+    if(trendEstimate > estimate) {
+      estimate = trendEstimate;
+    }
+  } else if(trendEstimate > 0 && lastTrendEstimate > 0
+            && fabs(trendEstimate / lastTrendEstimate - 1.0) <= MQ131_ALARM_TREND_TOLERANCE) {
+    // Trend settled, below the last reading (upper bound)
+    estimate = trendEstimate < ppb ? trendEstimate : ppb;
+  }
+  if(estimate < 0) {
+    return earlyLevel;
+  }
+
+  // Only raise the early warning above the current alarm level
+  // (clearing is left to the final reading)
+  uint8_t newLevel = evaluate(estimate, 0);
+  if(newLevel > earlyLevel && newLevel > level) {
+    earlyLevel = newLevel;
+    notify(earlyLevel, true);
+  }
+  return earlyLevel;
+}
+
+/**
+ * Do a full cycle with early warning during the warm-up
+ * The function gives back the hand only at the end
+ * of the read cycle!
+ */
+uint8_t MQ131AlarmClass::sample(MQ131Class& sensor) {
+  // The cold element has a higher Rs: the provisional readings fall towards
+  // the final one when the concentration rises with Rs
+  bool falling = sensor.getCurveB() > 0;
+  sensor.startSample();
+  while(!sensor.updateSample()) {
+    updateProvisional(sensor.getProvisionalO3(PPB), falling);
+    sensor.getHal()->wait(1000);
+  }
+  return update(sensor.getO3(PPB));
+}
+
+/**
+ * Get the alarm level of the last final reading
+ */
+uint8_t MQ131AlarmClass::getLevel() {
+  return level;
+}
+
+/**
+ * Get the early warning level of the current warm-up
+ */
+uint8_t MQ131AlarmClass::getEarlyWarningLevel() {
+  return earlyLevel;
+}
@@ -0,0 +1,125 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#ifndef _MQ131_ALARM_H_
+#define _MQ131_ALARM_H_
+
+#include <Arduino.h>
+#include "MQ131.h"
+
+// Alarm levels
+#define MQ131_ALARM_MAX_LEVELS                      4                 // Max number of alarm levels
+#define MQ131_ALARM_EARLY_READINGS                  5                 // Number of non-decreasing provisional readings in a row for an
+                                                                      // early warning on a lower bound
+#define MQ131_ALARM_TREND_READINGS                  8                 // Readings per block of the trend of the warm-up (three blocks
+                                                                      // extrapolated to the final reading)
+#define MQ131_ALARM_TREND_TOLERANCE                 0.1               // Max relative change of the extrapolation between two blocks
+                                                                      // before it is trusted (falling readings)
+
+// Function called when the alarm level changes
+// (level 0 = no alarm, early = true if raised during the warm-up; an early
+// warning not confirmed by the final reading is cancelled with early = false)
+typedef void (*MQ131AlarmCallback)(uint8_t level, bool early);
+
+class MQ131AlarmClass {
+	public:
+		// Constructor
+		MQ131AlarmClass();
+		virtual ~MQ131AlarmClass();
+
+		// Add an alarm level (threshold and hysteresis in ppb)
+		// The level is raised when the concentration reaches the threshold and
+		// cleared when it goes below threshold - hysteresis
+		// Levels must be added in increasing order of threshold
+		// Return false if there is no more room or the order is not respected
+		bool addLevel(float threshold, float hysteresis);
+
+		// Function called when the alarm level changes (optional)
+		void setCallback(MQ131AlarmCallback _callback);
+
+		// Evaluate a final reading (after sample()), return the alarm level
+		uint8_t update(float ppb);
+
+		// Evaluate a provisional reading during the warm-up (one per second),
+		// return the early warning level. The cold element has a higher Rs:
+		// with a curve rising with Rs (b > 0, WO3), the provisional readings
+		// fall towards the final one (falling = true); with a curve falling
+		// with Rs (b < 0, SnO2), they rise towards it and are a lower bound.
+		// The final reading is estimated from the trend of the warm-up (mean
+		// of ln(ppb) over three blocks of MQ131_ALARM_TREND_READINGS readings,
+		// extrapolated as an exponential transient) and, for a lower bound,
+		// from the last reading after MQ131_ALARM_EARLY_READINGS
+		// non-decreasing readings in a row (equal ADC codes accepted). The
+		// start of the warm-up is faster than an exponential: rising
+		// readings are extrapolated below the final one (lower bound),
+		// falling readings above it, so their extrapolation is only trusted
+		// once it changes by less than MQ131_ALARM_TREND_TOLERANCE between
+		// two blocks. The early warning is raised when the estimate reaches
+		// the threshold
+		uint8_t updateProvisional(float ppb, bool falling = false);
+
+		// Manage a full cycle of the sensor, return the alarm level
+		// (early warning during the warm-up in the direction given by the
+		// sign of the curve exponent)
+		uint8_t sample(MQ131Class& sensor);
+
+		// Current alarm level (0 = no alarm)
+		uint8_t getLevel();
+		uint8_t getEarlyWarningLevel();
+
+	private:
+		// Apply the thresholds and hysteresis from the current level
+		uint8_t evaluate(float ppb, uint8_t level);
+		void notify(uint8_t level, bool early);
+
+		// Alarm levels
+		float thresholds[MQ131_ALARM_MAX_LEVELS];
+		float hysteresis[MQ131_ALARM_MAX_LEVELS];
+		uint8_t levelCount = 0;
+
+		// Current state
+		uint8_t level = 0;
+		uint8_t earlyLevel = 0;
+		float lastProvisional = 0;
+		uint8_t monotonicReadings = 0;
+
+		// Trend of the warm-up: mean of ln(ppb) of the last three blocks
+		float trendSum = 0;
+		uint8_t trendCount = 0;
+		uint8_t trendBlocks = 0;
+		float trendMeans[3];
+		float trendEstimate = -1;
+		float lastTrendEstimate = -1;
+
+		// Notification
+		MQ131AlarmCallback callback = NULL;
+};
+
+#endif // _MQ131_ALARM_H_
@@ -0,0 +1,134 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#include "MQ131Batch.h"
+
+/**
+ * Constructor, nothing special to do
+ */
+MQ131BatchClass::MQ131BatchClass() {
+}
+
+/**
+ * Destructor, nothing special to do
+ */
+MQ131BatchClass::~MQ131BatchClass() {
+}
+
+/**
+ * Add a sensor to the batch
+ */
+bool MQ131BatchClass::add(MQ131Class* sensor) {
+  if(count >= MQ131_BATCH_MAX_SENSORS) {
+    return false;
+  }
+  sensors[count++] = sensor;
+  return true;
+}
+
+/**
+ * Get the number of sensors in the batch
+ */
+uint8_t MQ131BatchClass::getCount() {
+  return count;
+}
+
+/**
+ * Define the clock pacing the batch
+ */
+void MQ131BatchClass::setClock(MQ131Hal* _clock) {
+  clock = _clock;
+}
+
+/**
+ * Calibrate all the sensors from one loop
+ */
+void MQ131BatchClass::calibrate(Stream* reportStream) {
+  bool done[MQ131_BATCH_MAX_SENSORS];
+  uint8_t remaining = count;
+
+  for(uint8_t i = 0; i < count; i++) {
+    done[i] = false;
+    sensors[i]->startCalibration();
+  }
+
+  // One reading per sensor every second (the time to read is counted
+  // in readings, so keep the pace whatever the number of sensors)
+  // A single clock paces the batch (same board for the batch)
+  MQ131Hal* hal = clock != NULL ? clock : count > 0 ? sensors[0]->getHal() : NULL;
+  uint32_t nextStep = hal != NULL ? hal->getMillis() : 0;
+  while(remaining > 0) {
+    for(uint8_t i = 0; i < count; i++) {
+      if(!done[i] && sensors[i]->updateCalibration()) {
+        done[i] = true;
+        remaining--;
+      }
+    }
+    nextStep += 1000;
+    uint32_t now = hal->getMillis();
+    int32_t wait = (int32_t)(nextStep - now);
+    if(wait <= 0) {
+      // Overrun (the readings took more than one second): restart the
+      // pace from now instead of catching up with back to back steps
+      nextStep = now;
+    } else if(remaining > 0) {
+      hal->wait(wait);
+    }
+  }
+
+  if(reportStream != NULL) {
+    printReport(reportStream);
+  }
+}
+
+/**
+ * Print the calibration report
+ */
+void MQ131BatchClass::printReport(Stream* reportStream) {
+  reportStream->println(F("Sensor;R0 (Ohms);Time to read (s);Stable readings;Std dev (Ohms);Slope (Ohms/s);Max deviation (%);Timed out"));
+  for(uint8_t i = 0; i < count; i++) {
+    MQ131CalibrationStats stats = sensors[i]->getCalibrationStats();
+    reportStream->print(i);
+    reportStream->print(F(";"));
+    reportStream->print(sensors[i]->getR0());
+    reportStream->print(F(";"));
+    reportStream->print(sensors[i]->getTimeToRead());
+    reportStream->print(F(";"));
+    reportStream->print(stats.stableSamples);
+    reportStream->print(F(";"));
+    reportStream->print(stats.stdDevRs);
+    reportStream->print(F(";"));
+    reportStream->print(stats.slopeRs);
+    reportStream->print(F(";"));
+    reportStream->print(stats.maxDeviation * 100.0);
+    reportStream->print(F(";"));
+    reportStream->println(stats.timedOut ? 1 : 0);
+  }
+}
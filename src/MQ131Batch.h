@@ -0,0 +1,75 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#ifndef _MQ131_BATCH_H_
+#define _MQ131_BATCH_H_
+
+#include <Arduino.h>
+#include "MQ131.h"
+
+// Max number of sensors calibrated together
+#ifndef MQ131_BATCH_MAX_SENSORS
+#define MQ131_BATCH_MAX_SENSORS                     16
+#endif
+
+class MQ131BatchClass {
+	public:
+		// Constructor
+		MQ131BatchClass();
+		virtual ~MQ131BatchClass();
+
+		// Add a sensor (already initialized with begin()) to the batch
+		// Return false if the batch is full
+		bool add(MQ131Class* sensor);
+		uint8_t getCount();
+
+		// Clock pacing the whole batch (default: the one of the first sensor)
+		void setClock(MQ131Hal* _clock);
+
+		// Calibrate all the sensors at the same time (one reading per sensor
+		// every second), each sensor converges independently
+		// The function gives back the hand when all sensors are calibrated
+		// The report (one line per sensor) is printed on the stream, if any
+		void calibrate(Stream* reportStream = NULL);
+
+		// Print the calibration report (one line per sensor with R0, time to
+		// read and the quality of the calibration)
+		void printReport(Stream* reportStream);
+
+	private:
+		// Sensors of the batch
+		MQ131Class* sensors[MQ131_BATCH_MAX_SENSORS];
+		uint8_t count = 0;
+
+		// Single clock of the batch (NULL: the one of the first sensor)
+		MQ131Hal* clock = NULL;
+};
+
+#endif // _MQ131_BATCH_H_
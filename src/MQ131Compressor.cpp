@@ -0,0 +1,146 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#include "MQ131Compressor.h"
+
+/**
+ * Constructor, start a new series
+ */
+MQ131CompressorClass::MQ131CompressorClass() {
+  reset();
+}
+
+/**
+ * Destructor, nothing special to do
+ */
+MQ131CompressorClass::~MQ131CompressorClass() {
+}
+
+/**
+ * Start a new series (the first timestamp and value are encoded
+ * as deltas from 0)
+ */
+void MQ131CompressorClass::reset() {
+  lastTimestamp = 0;
+  lastDelta = 0;
+  lastValue = 0;
+}
+
+/**
+ * Encode a reading
+ */
+uint8_t MQ131CompressorClass::encode(uint32_t timestamp, float ppb, uint8_t* data, uint8_t size) {
+  // Bound the concentration before the conversion to an integer
+  // (undefined for NaN and out of range values, e.g. a saturated reading)
+  if(isnan(ppb)) {
+    ppb = 0;
+  } else if(ppb > MQ131_COMPRESS_MAX_PPB) {
+    ppb = MQ131_COMPRESS_MAX_PPB;
+  } else if(ppb < -MQ131_COMPRESS_MAX_PPB) {
+    ppb = -MQ131_COMPRESS_MAX_PPB;
+  }
+  int32_t value = (int32_t)(ppb * MQ131_COMPRESS_SCALE + (ppb < 0 ? -0.5 : 0.5));
+  uint32_t delta = timestamp - lastTimestamp;
+
+  // Differences computed on unsigned integers (wrap instead of overflow)
+  uint8_t length = writeVarint((int32_t)(delta - (uint32_t)lastDelta), data, size);
+  if(length == 0) {
+    return 0;
+  }
+  uint8_t lengthValue = writeVarint(value - lastValue, &data[length], size - length);
+  if(lengthValue == 0) {
+    return 0;
+  }
+
+  lastTimestamp = timestamp;
+  lastDelta = (int32_t)delta;
+  lastValue = value;
+  return length + lengthValue;
+}
+
+/**
+ * Decode a reading
+ */
+uint8_t MQ131CompressorClass::decode(const uint8_t* data, uint8_t size, uint32_t& timestamp, float& ppb) {
+  int32_t deltaOfDelta;
+  int32_t deltaValue;
+  uint8_t length = readVarint(data, size, deltaOfDelta);
+  if(length == 0) {
+    return 0;
+  }
+  uint8_t lengthValue = readVarint(&data[length], size - length, deltaValue);
+  if(lengthValue == 0) {
+    return 0;
+  }
+
+  // Sums on unsigned integers (a corrupted series wraps instead of overflow)
+  lastDelta = (int32_t)((uint32_t)lastDelta + (uint32_t)deltaOfDelta);
+  lastTimestamp += (uint32_t)lastDelta;
+  lastValue = (int32_t)((uint32_t)lastValue + (uint32_t)deltaValue);
+
+  timestamp = lastTimestamp;
+  ppb = (float)lastValue / MQ131_COMPRESS_SCALE;
+  return length + lengthValue;
+}
+
+/**
+ * Write a signed value (zigzag) in variable length
+ */
+uint8_t MQ131CompressorClass::writeVarint(int32_t value, uint8_t* data, uint8_t size) {
+  uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+  uint8_t length = 0;
+  do {
+    if(length >= size) {
+      return 0;
+    }
+    uint8_t byte = zigzag & 0x7F;
+    zigzag >>= 7;
+    if(zigzag != 0) {
+      byte |= 0x80;
+    }
+    data[length++] = byte;
+  } while(zigzag != 0);
+  return length;
+}
+
+/**
+ * Read a signed value (zigzag) in variable length
+ */
+uint8_t MQ131CompressorClass::readVarint(const uint8_t* data, uint8_t size, int32_t& value) {
+  uint32_t zigzag = 0;
+  for(uint8_t length = 0; length < size && length < 5; length++) {
+    zigzag |= (uint32_t)(data[length] & 0x7F) << (7 * length);
+    if((data[length] & 0x80) == 0) {
+      value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+      return length + 1;
+    }
+  }
+  return 0;
+}
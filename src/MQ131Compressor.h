@@ -0,0 +1,79 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#ifndef _MQ131_COMPRESSOR_H_
+#define _MQ131_COMPRESSOR_H_
+
+#include <Arduino.h>
+
+// Resolution of the compressed concentration (1/10 ppb)
+#define MQ131_COMPRESS_SCALE                        10
+// Max size of one compressed reading (two varints of 32 bits)
+#define MQ131_COMPRESS_MAX_BYTES                    10
+// Max concentration encoded (ppb), larger values saturate and NaN is
+// encoded as 0 (the quantized values and their deltas stay in 32 bits)
+#define MQ131_COMPRESS_MAX_PPB                      100000000.0
+
+// Streaming compression of a series of readings (timestamp, ppb)
+// - timestamps: delta of delta (0 for a regular sampling period)
+// - concentration: delta of the value quantized to MQ131_COMPRESS_SCALE
+// Both are zigzag encoded in variable length integers (7 bits per byte),
+// so a regular series with small variations takes 2 bytes per reading
+// The deltas wrap on 32 bits (any timestamp jump is decoded exactly)
+// Use one instance to encode and another one to decode the same series
+class MQ131CompressorClass {
+	public:
+		// Constructor
+		MQ131CompressorClass();
+		virtual ~MQ131CompressorClass();
+
+		// Start a new series
+		void reset();
+
+		// Encode a reading in the buffer
+		// Return the number of bytes written (0 if the buffer is too small)
+		uint8_t encode(uint32_t timestamp, float ppb, uint8_t* data, uint8_t size);
+
+		// Decode a reading from the buffer
+		// Return the number of bytes read (0 if the buffer is incomplete)
+		uint8_t decode(const uint8_t* data, uint8_t size, uint32_t& timestamp, float& ppb);
+
+	private:
+		// Variable length integers (zigzag for signed values)
+		static uint8_t writeVarint(int32_t value, uint8_t* data, uint8_t size);
+		static uint8_t readVarint(const uint8_t* data, uint8_t size, int32_t& value);
+
+		// State of the series
+		uint32_t lastTimestamp = 0;
+		int32_t lastDelta = 0;
+		int32_t lastValue = 0;
+};
+
+#endif // _MQ131_COMPRESSOR_H_
@@ -0,0 +1,90 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#include "MQ131Frame.h"
+
+/**
+ * Constructor, nothing special to do
+ */
+MQ131FrameClass::MQ131FrameClass() {
+}
+
+/**
+ * Destructor, nothing special to do
+ */
+MQ131FrameClass::~MQ131FrameClass() {
+}
+
+/**
+ * Define the output and the identifier of the sensor
+ */
+void MQ131FrameClass::begin(Stream* _output, uint16_t _sensorId) {
+  output = _output;
+  sensorId = _sensorId;
+  sequence = 0;
+}
+
+/**
+ * Send the last reading of the sensor
+ */
+bool MQ131FrameClass::write(MQ131Class& sensor, uint32_t timestamp) {
+  return write(timestamp, sensor.getO3(PPB), sensor.getRawADC());
+}
+
+/**
+ * Send a reading in one frame
+ */
+bool MQ131FrameClass::write(uint32_t timestamp, float ppb, uint16_t adc) {
+  if(output == NULL) {
+    return false;
+  }
+
+  uint8_t frame[MQ131_FRAME_SIZE];
+  uint32_t value;
+  memcpy(&value, &ppb, sizeof(value));
+
+  frame[0] = MQ131_FRAME_SYNC_0;
+  frame[1] = MQ131_FRAME_SYNC_1;
+  frame[2] = sensorId;
+  frame[3] = sensorId >> 8;
+  for(uint8_t i = 0; i < 4; i++) {
+    frame[4 + i] = sequence >> (8 * i);
+    frame[8 + i] = timestamp >> (8 * i);
+    frame[12 + i] = value >> (8 * i);
+  }
+  frame[16] = adc;
+  frame[17] = adc >> 8;
+  uint16_t crc = MQ131LogClass::crc16(&frame[2], MQ131_FRAME_SIZE - 4);
+  frame[18] = crc;
+  frame[19] = crc >> 8;
+
+  sequence++;
+  return output->write(frame, MQ131_FRAME_SIZE) == MQ131_FRAME_SIZE;
+}
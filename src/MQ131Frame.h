@@ -0,0 +1,67 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#ifndef _MQ131_FRAME_H_
+#define _MQ131_FRAME_H_
+
+#include <Arduino.h>
+#include "MQ131.h"
+#include "MQ131Log.h"
+
+// Binary frame of a reading sent to a gateway (little endian)
+// sync 'M' 'Q' (2), sensor id (2), sequence (4), timestamp (4),
+// concentration in ppb (float, 4), ADC code (2), CRC16 of bytes 2 to 17 (2)
+#define MQ131_FRAME_SIZE                            20
+#define MQ131_FRAME_SYNC_0                          'M'
+#define MQ131_FRAME_SYNC_1                          'Q'
+
+class MQ131FrameClass {
+	public:
+		// Constructor
+		MQ131FrameClass();
+		virtual ~MQ131FrameClass();
+
+		// Define the output and the identifier of the sensor
+		void begin(Stream* _output, uint16_t _sensorId);
+
+		// Send the last reading of the sensor (after sample())
+		bool write(MQ131Class& sensor, uint32_t timestamp);
+		// Send a reading
+		bool write(uint32_t timestamp, float ppb, uint16_t adc);
+
+	private:
+		// Output and identification
+		Stream* output = NULL;
+		uint16_t sensorId = 0;
+		// Sequence of the frames (gaps detected by the gateway)
+		uint32_t sequence = 0;
+};
+
+#endif // _MQ131_FRAME_H_
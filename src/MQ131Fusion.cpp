@@ -0,0 +1,126 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#include "MQ131Fusion.h"
+
+/**
+ * Constructor, keep the load resistances for begin()
+ */
+MQ131FusionClass::MQ131FusionClass(uint32_t _RLLow, uint32_t _RLHigh)
+  : sensorLow(_RLLow), sensorHigh(_RLHigh) {
+  valueRLLow = _RLLow;
+  valueRLHigh = _RLHigh;
+}
+
+/**
+ * Destructor, nothing special to do
+ */
+MQ131FusionClass::~MQ131FusionClass() {
+}
+
+/**
+ * Init both sensors
+ */
+void MQ131FusionClass::begin(uint8_t _pinPowerLow, uint8_t _pinSensorLow,
+                             uint8_t _pinPowerHigh, uint8_t _pinSensorHigh,
+                             Stream* _debugStream) {
+  sensorLow.begin(_pinPowerLow, _pinSensorLow, LOW_CONCENTRATION, valueRLLow, _debugStream);
+  sensorHigh.begin(_pinPowerHigh, _pinSensorHigh, HIGH_CONCENTRATION, valueRLHigh, _debugStream);
+}
+
+/**
+ * Do a full cycle on both sensors with overlapped heater windows
+ * The function gives back the hand only at the end
+ * of the read cycle of both sensors!
+ */
+void MQ131FusionClass::sample() {
+  sensorLow.startSample();
+  sensorHigh.startSample();
+
+  bool doneLow = false;
+  bool doneHigh = false;
+  while(true) {
+    if(!doneLow) {
+      doneLow = sensorLow.updateSample();
+    }
+    if(!doneHigh) {
+      doneHigh = sensorHigh.updateSample();
+    }
+    if(doneLow && doneHigh) {
+      return;
+    }
+    sensorLow.getHal()->wait(1000);
+  }
+}
+
+/**
+ * Get gas concentration for O3 from the sensor matching the range
+ */
+float MQ131FusionClass::getO3(MQ131Unit unit) {
+  float concentration = fuse(sensorLow.getO3(PPB), sensorHigh.getO3(PPB));
+
+  return sensorLow.convert(concentration, PPB, unit);
+}
+
+/**
+ * Cross-fade both readings
+ * The gate and the weight come from the same estimate (geometric mean of
+ * both readings), so the output has no jump when the sensors disagree
+ */
+float MQ131FusionClass::fuse(float lowPpb, float highPpb) {
+  // Weight of the high concentration sensor
+  float weight = 0.0;
+  if(lowPpb > 0 && highPpb > 0) {
+    weight = 0.5 * log(lowPpb * highPpb / ((float)MQ131_FUSION_LOW_MAX_PPB * MQ131_FUSION_LOW_MAX_PPB))
+           / log((float)MQ131_FUSION_HIGH_MIN_PPB / MQ131_FUSION_LOW_MAX_PPB);
+    if(weight < 0.0) {
+      weight = 0.0;
+    }
+    if(weight > 1.0) {
+      weight = 1.0;
+    }
+  }
+
+  return (1.0 - weight) * lowPpb + weight * highPpb;
+}
+
+/**
+ * Get the low concentration sensor
+ */
+MQ131Class& MQ131FusionClass::getLowSensor() {
+  return sensorLow;
+}
+
+/**
+ * Get the high concentration sensor
+ */
+MQ131Class& MQ131FusionClass::getHighSensor() {
+  return sensorHigh;
+}
@@ -0,0 +1,81 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#ifndef _MQ131_FUSION_H_
+#define _MQ131_FUSION_H_
+
+#include <Arduino.h>
+#include "MQ131.h"
+
+// Range of each sensor (in ppb) for the automatic range selection
+// The range is taken from the geometric mean of both readings:
+// below the low limit, only the LOW_CONCENTRATION sensor is used,
+// above the high limit, only the HIGH_CONCENTRATION sensor is used,
+// in between, both values are cross-faded (on a logarithmic scale)
+#define MQ131_FUSION_LOW_MAX_PPB                    1000              // Upper limit of the low concentration sensor (1 ppm)
+#define MQ131_FUSION_HIGH_MIN_PPB                   10000             // Lower limit of the high concentration sensor (10 ppm)
+
+class MQ131FusionClass {
+	public:
+		// Constructor (load resistance of each sensor)
+		MQ131FusionClass(uint32_t _RLLow, uint32_t _RLHigh);
+		virtual ~MQ131FusionClass();
+
+		// Initialize both sensors
+		void begin(uint8_t _pinPowerLow, uint8_t _pinSensorLow,
+		           uint8_t _pinPowerHigh, uint8_t _pinSensorHigh,
+		           Stream* _debugStream = NULL);
+
+		// Manage a full cycle of both sensors (heaters started together,
+		// so the cycle takes the time to read of the slowest sensor)
+		void sample();
+
+		// Read the concentration of gas with automatic range selection
+		float getO3(MQ131Unit unit);
+
+		// Combine a reading of each sensor (ppb) as getO3() does
+		// (continuous in both readings)
+		float fuse(float lowPpb, float highPpb);
+
+		// Access to each sensor (calibration, environment...)
+		MQ131Class& getLowSensor();
+		MQ131Class& getHighSensor();
+
+	private:
+		// Sensors
+		MQ131Class sensorLow;
+		MQ131Class sensorHigh;
+
+		// Load resistances
+		uint32_t valueRLLow;
+		uint32_t valueRLHigh;
+};
+
+#endif // _MQ131_FUSION_H_
@@ -0,0 +1,194 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#include "MQ131Index.h"
+
+// Breakpoints of the US EPA air quality index for ozone
+// (concentration low and high in ppb, index low and high)
+static const uint16_t MQ131_INDEX_8HOUR[] PROGMEM = {
+    0,  54,   0,  50,
+   55,  70,  51, 100,
+   71,  85, 101, 150,
+   86, 105, 151, 200,
+  106, 200, 201, 300
+};
+static const uint16_t MQ131_INDEX_1HOUR[] PROGMEM = {
+  125, 164, 101, 150,
+  165, 204, 151, 200,
+  205, 404, 201, 300,
+  405, 504, 301, 400,
+  505, 604, 401, 500
+};
+
+/**
+ * Constructor, empty buckets
+ */
+MQ131IndexClass::MQ131IndexClass() {
+  for(uint8_t i = 0; i <= MQ131_INDEX_HOURS; i++) {
+    bucketSum[i] = 0;
+    bucketCount[i] = 0;
+  }
+}
+
+/**
+ * Destructor, nothing special to do
+ */
+MQ131IndexClass::~MQ131IndexClass() {
+}
+
+/**
+ * Add the last reading of the sensor
+ */
+void MQ131IndexClass::update(MQ131Class& sensor) {
+  update(sensor.getO3(PPM), sensor.getHal()->getMillis() / 1000);
+}
+
+/**
+ * Add a reading in the bucket of its hour
+ */
+void MQ131IndexClass::update(float ppm, uint32_t sec) {
+  uint32_t hour = sec / 3600;
+
+  if(!started) {
+    started = true;
+    hourCurrent = hour;
+  }
+
+  // Move to the bucket of the new hour (empty the skipped hours)
+  // If the time goes backward (e.g. millis() overflow), start again
+  uint32_t elapsed = hour - hourCurrent;
+  if(hour < hourCurrent || elapsed > MQ131_INDEX_HOURS) {
+    elapsed = MQ131_INDEX_HOURS + 1;
+  }
+  for(uint32_t i = 0; i < elapsed; i++) {
+    bucketCurrent = (bucketCurrent + 1) % (MQ131_INDEX_HOURS + 1);
+    bucketSum[bucketCurrent] = 0;
+    bucketCount[bucketCurrent] = 0;
+  }
+  hourCurrent = hour;
+
+  bucketSum[bucketCurrent] += ppm;
+  if(bucketCount[bucketCurrent] < 0xFFFF) {
+    bucketCount[bucketCurrent]++;
+  }
+}
+
+/**
+ * Average of the last completed hour
+ */
+float MQ131IndexClass::get1HourAverage() {
+  uint8_t bucket = (bucketCurrent + MQ131_INDEX_HOURS) % (MQ131_INDEX_HOURS + 1);
+  if(bucketCount[bucket] == 0) {
+    return -1;
+  }
+  return bucketSum[bucket] / bucketCount[bucket];
+}
+
+/**
+ * Average of the hourly averages of the last 8 completed hours
+ */
+float MQ131IndexClass::get8HourAverage() {
+  float sum = 0;
+  uint8_t hours = 0;
+  for(uint8_t i = 1; i <= MQ131_INDEX_HOURS; i++) {
+    uint8_t bucket = (bucketCurrent + MQ131_INDEX_HOURS + 1 - i) % (MQ131_INDEX_HOURS + 1);
+    if(bucketCount[bucket] > 0) {
+      sum += bucketSum[bucket] / bucketCount[bucket];
+      hours++;
+    }
+  }
+  if(hours < MQ131_INDEX_MIN_HOURS) {
+    return -1;
+  }
+  return sum / hours;
+}
+
+/**
+ * Interpolate the index from a table of breakpoints
+ * Negative if the concentration is not in the table
+ */
+int16_t MQ131IndexClass::getIndex(float ppm, const uint16_t* breakpoints, uint8_t count) {
+  // Outside of the tables (and of uint16_t in ppb)
+  if(ppm < 0 || ppm > 65.0) {
+    return -1;
+  }
+  // Concentration truncated to the ppb (3 decimals in ppm), with a small
+  // margin for the rounding of float
+  uint16_t ppb = (uint16_t)(ppm * 1000.0 + 0.001);
+  for(uint8_t i = 0; i < count; i++) {
+    uint16_t cLow = pgm_read_word(&breakpoints[i * 4]);
+    uint16_t cHigh = pgm_read_word(&breakpoints[i * 4 + 1]);
+    if(ppb >= cLow && ppb <= cHigh) {
+      uint16_t iLow = pgm_read_word(&breakpoints[i * 4 + 2]);
+      uint16_t iHigh = pgm_read_word(&breakpoints[i * 4 + 3]);
+      return (int16_t)((float)(iHigh - iLow) / (cHigh - cLow) * (ppb - cLow) + iLow + 0.5);
+    }
+  }
+  return -1;
+}
+
+/**
+ * Air quality index for ozone (max of the 8-hour and 1-hour indexes)
+ */
+int16_t MQ131IndexClass::getIndex() {
+  int16_t index8Hour = getIndex(get8HourAverage(), MQ131_INDEX_8HOUR, 5);
+  int16_t index1Hour = getIndex(get1HourAverage(), MQ131_INDEX_1HOUR, 5);
+  // Over the last breakpoint of the 1-hour table, beyond the index
+  if(index1Hour < 0 && get1HourAverage() > 0.604) {
+    index1Hour = 500;
+  }
+  return index8Hour > index1Hour ? index8Hour : index1Hour;
+}
+
+/**
+ * Category of the air quality index
+ */
+MQ131IndexCategory MQ131IndexClass::getCategory() {
+  int16_t index = getIndex();
+  if(index < 0) {
+    return AQI_UNKNOWN;
+  }
+  if(index <= 50) {
+    return AQI_GOOD;
+  }
+  if(index <= 100) {
+    return AQI_MODERATE;
+  }
+  if(index <= 150) {
+    return AQI_UNHEALTHY_SENSITIVE;
+  }
+  if(index <= 200) {
+    return AQI_UNHEALTHY;
+  }
+  if(index <= 300) {
+    return AQI_VERY_UNHEALTHY;
+  }
+  return AQI_HAZARDOUS;
+}
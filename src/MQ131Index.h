@@ -0,0 +1,77 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#ifndef _MQ131_INDEX_H_
+#define _MQ131_INDEX_H_
+
+#include <Arduino.h>
+#include "MQ131.h"
+
+// Rolling windows for the ozone index (US EPA)
+#define MQ131_INDEX_HOURS                           8                 // Number of hourly buckets kept (8-hour average)
+#define MQ131_INDEX_MIN_HOURS                       6                 // Min number of hours with data for the 8-hour average (75%)
+
+enum MQ131IndexCategory {AQI_UNKNOWN, AQI_GOOD, AQI_MODERATE, AQI_UNHEALTHY_SENSITIVE,
+                         AQI_UNHEALTHY, AQI_VERY_UNHEALTHY, AQI_HAZARDOUS};
+
+class MQ131IndexClass {
+	public:
+		// Constructor
+		MQ131IndexClass();
+		virtual ~MQ131IndexClass();
+
+		// Add a reading of the sensor (after sample()), timestamp from millis()
+		void update(MQ131Class& sensor);
+		// Add a reading in ppm with its timestamp (in seconds)
+		void update(float ppm, uint32_t sec);
+
+		// Rolling averages in ppm (negative if not enough data)
+		float get1HourAverage();
+		float get8HourAverage();
+
+		// Air quality index for ozone (max of the 1-hour and 8-hour indexes)
+		// Negative if not enough data
+		int16_t getIndex();
+		MQ131IndexCategory getCategory();
+
+	private:
+		// Compute the index from the breakpoints
+		int16_t getIndex(float ppm, const uint16_t* breakpoints, uint8_t count);
+
+		// Hourly buckets (ring buffer): sum of the readings and count
+		// The completed hours and the current hour
+		float bucketSum[MQ131_INDEX_HOURS + 1];
+		uint16_t bucketCount[MQ131_INDEX_HOURS + 1];
+		uint8_t bucketCurrent = 0;
+		uint32_t hourCurrent = 0;
+		bool started = false;
+};
+
+#endif // _MQ131_INDEX_H_
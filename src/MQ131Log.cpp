@@ -0,0 +1,337 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#include "MQ131Log.h"
+
+/**
+ * Constructor, nothing special to do
+ */
+MQ131LogClass::MQ131LogClass() {
+}
+
+/**
+ * Destructor, nothing special to do
+ */
+MQ131LogClass::~MQ131LogClass() {
+}
+
+/**
+ * Open the log and find its end
+ */
+bool MQ131LogClass::begin(MQ131LogStorage* _storage, uint8_t* _buffer) {
+  storage = _storage;
+  buffer = _buffer;
+
+  uint16_t pageSize = storage->getPageSize();
+  uint32_t eraseSize = storage->getEraseSize();
+  uint32_t size = storage->getSize();
+  if(pageSize < MQ131_LOG_RECORD_SIZE || pageSize % MQ131_LOG_RECORD_SIZE != 0
+     || eraseSize % pageSize != 0 || size % eraseSize != 0 || size < 2 * eraseSize) {
+    return false;
+  }
+
+  capacity = size / MQ131_LOG_RECORD_SIZE;
+  recordsPerPage = pageSize / MQ131_LOG_RECORD_SIZE;
+  recordsPerBlock = eraseSize / MQ131_LOG_RECORD_SIZE;
+
+  return recover();
+}
+
+/**
+ * Find the end of the log: the block with the highest sequence, then
+ * the last used slot in this block
+ * Only one record per block is read, except in the last block
+ */
+bool MQ131LogClass::recover() {
+  uint8_t data[MQ131_LOG_RECORD_SIZE];
+  MQ131Record record;
+  bool found = false;
+  uint32_t lastBlockSequence = 0;
+
+  for(uint32_t slot = 0; slot < capacity; slot += recordsPerBlock) {
+    // First valid record of the block (usually the first slot)
+    for(uint32_t offset = 0; offset < recordsPerBlock; offset++) {
+      if(!storage->read((slot + offset) * MQ131_LOG_RECORD_SIZE, data, MQ131_LOG_RECORD_SIZE)) {
+        return false;
+      }
+      if(isErased(data)) {
+        break;
+      }
+      // Skip records corrupted or not at their place
+      if(!decode(data, record) || record.sequence % capacity != slot + offset) {
+        continue;
+      }
+      uint32_t blockSequence = record.sequence - offset;
+      if(!found || blockSequence > lastBlockSequence) {
+        lastBlockSequence = blockSequence;
+        found = true;
+      }
+      break;
+    }
+  }
+
+  nextSequence = 0;
+  if(found) {
+    // After the last slot used (even corrupted) of the last block
+    nextSequence = lastBlockSequence + 1;
+    uint32_t address = getAddress(lastBlockSequence);
+    for(uint32_t offset = 1; offset < recordsPerBlock; offset++) {
+      if(!storage->read(address + offset * MQ131_LOG_RECORD_SIZE, data, MQ131_LOG_RECORD_SIZE)) {
+        return false;
+      }
+      if(!isErased(data)) {
+        nextSequence = lastBlockSequence + offset + 1;
+      }
+    }
+  }
+  flushedSequence = nextSequence;
+
+  // Partial page: reload the records already written in the buffer
+  uint16_t inPage = nextSequence % recordsPerPage;
+  if(inPage > 0) {
+    uint32_t pageSequence = nextSequence - inPage;
+    if(!storage->read(getAddress(pageSequence), buffer, inPage * MQ131_LOG_RECORD_SIZE)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Append a record to the log
+ */
+bool MQ131LogClass::append(uint32_t timestamp, float ppb, uint16_t adc, uint32_t rl, float supply, uint8_t loadResistor) {
+  if(storage == NULL) {
+    return false;
+  }
+
+  // Entering a new block: erase it first (oldest records are lost)
+  if(nextSequence % recordsPerBlock == 0) {
+    if(!storage->erase(getAddress(nextSequence))) {
+      return false;
+    }
+  }
+
+  MQ131Record record;
+  record.sequence = nextSequence;
+  record.timestamp = timestamp;
+  record.ppb = ppb;
+  record.adc = adc;
+  record.loadResistor = loadResistor;
+  record.rl = rl;
+  record.supply = supply;
+  encode(record, &buffer[(nextSequence % recordsPerPage) * MQ131_LOG_RECORD_SIZE]);
+  nextSequence++;
+
+  // Page full, write it
+  if(nextSequence % recordsPerPage == 0) {
+    return flush();
+  }
+  return true;
+}
+
+/**
+ * Append the last reading of the sensor
+ */
+bool MQ131LogClass::append(MQ131Class& sensor, uint32_t timestamp) {
+  return append(timestamp, sensor.getO3(PPB), sensor.getRawADC(), sensor.getRL(), sensor.getSupply(),
+                sensor.getLoadResistorIndex());
+}
+
+/**
+ * Write the records of the buffer not yet on the storage
+ * (always inside the current page)
+ */
+bool MQ131LogClass::flush() {
+  if(storage == NULL || flushedSequence == nextSequence) {
+    return true;
+  }
+  uint16_t offset = (flushedSequence % recordsPerPage) * MQ131_LOG_RECORD_SIZE;
+  uint16_t length = (nextSequence - flushedSequence) * MQ131_LOG_RECORD_SIZE;
+  if(!storage->write(getAddress(flushedSequence), &buffer[offset], length)) {
+    return false;
+  }
+  flushedSequence = nextSequence;
+  return true;
+}
+
+/**
+ * Get the oldest sequence still on the storage
+ * (all blocks but the current one are full)
+ */
+uint32_t MQ131LogClass::getFirstSequence() {
+  uint32_t blockSequence = nextSequence - nextSequence % recordsPerBlock;
+  uint32_t kept = capacity - recordsPerBlock;
+  if(blockSequence < kept) {
+    return 0;
+  }
+  return blockSequence - kept;
+}
+
+/**
+ * Get the sequence of the next record
+ */
+uint32_t MQ131LogClass::getNextSequence() {
+  return nextSequence;
+}
+
+/**
+ * Read a record from the buffer or from the storage
+ */
+bool MQ131LogClass::read(uint32_t sequence, MQ131Record& record) {
+  if(storage == NULL || sequence >= nextSequence || sequence < getFirstSequence()) {
+    return false;
+  }
+  uint8_t data[MQ131_LOG_RECORD_SIZE];
+  const uint8_t* source = data;
+  if(sequence >= flushedSequence) {
+    source = &buffer[(sequence % recordsPerPage) * MQ131_LOG_RECORD_SIZE];
+  } else if(!storage->read(getAddress(sequence), data, MQ131_LOG_RECORD_SIZE)) {
+    return false;
+  }
+  return decode(source, record) && record.sequence == sequence;
+}
+
+/**
+ * Export the records compressed (timestamp and ppb), the series starts
+ * at the first record exported. Missing or corrupted records are skipped
+ */
+uint32_t MQ131LogClass::exportCompressed(Stream& output, uint32_t fromSequence) {
+  MQ131CompressorClass compressor;
+  MQ131Record record;
+  uint8_t data[MQ131_COMPRESS_MAX_BYTES];
+  uint32_t count = 0;
+
+  if(fromSequence < getFirstSequence()) {
+    fromSequence = getFirstSequence();
+  }
+  for(uint32_t sequence = fromSequence; sequence < nextSequence; sequence++) {
+    if(!read(sequence, record)) {
+      continue;
+    }
+    uint8_t length = compressor.encode(record.timestamp, record.ppb, data, sizeof(data));
+    output.write(data, length);
+    count++;
+  }
+  return count;
+}
+
+/**
+ * Address of a sequence on the storage (circular)
+ */
+uint32_t MQ131LogClass::getAddress(uint32_t sequence) {
+  return (sequence % capacity) * MQ131_LOG_RECORD_SIZE;
+}
+
+/**
+ * CRC16-CCITT (polynomial 0x1021, initial value 0xFFFF)
+ */
+uint16_t MQ131LogClass::crc16(const uint8_t* data, uint8_t length) {
+  uint16_t crc = 0xFFFF;
+  for(uint8_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for(uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+/**
+ * Write a 32-bit value in little endian
+ */
+static void writeUInt32(uint8_t* data, uint32_t value) {
+  data[0] = value;
+  data[1] = value >> 8;
+  data[2] = value >> 16;
+  data[3] = value >> 24;
+}
+
+/**
+ * Read a 32-bit value in little endian
+ */
+static uint32_t readUInt32(const uint8_t* data) {
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8)
+       | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/**
+ * Serialize a record with its CRC
+ */
+void MQ131LogClass::encode(const MQ131Record& record, uint8_t* data) {
+  uint32_t ppb;
+  uint32_t supply;
+  memcpy(&ppb, &record.ppb, sizeof(ppb));
+  memcpy(&supply, &record.supply, sizeof(supply));
+  memset(data, 0, MQ131_LOG_RECORD_SIZE);
+  writeUInt32(&data[0], record.sequence);
+  writeUInt32(&data[4], record.timestamp);
+  writeUInt32(&data[8], ppb);
+  data[12] = record.adc;
+  data[13] = record.adc >> 8;
+  data[14] = record.loadResistor;
+  writeUInt32(&data[16], record.rl);
+  writeUInt32(&data[20], supply);
+  uint16_t crc = crc16(data, MQ131_LOG_RECORD_SIZE - 2);
+  data[MQ131_LOG_RECORD_SIZE - 2] = crc;
+  data[MQ131_LOG_RECORD_SIZE - 1] = crc >> 8;
+}
+
+/**
+ * Deserialize a record, false if the CRC is wrong
+ */
+bool MQ131LogClass::decode(const uint8_t* data, MQ131Record& record) {
+  uint16_t crc = data[MQ131_LOG_RECORD_SIZE - 2] | ((uint16_t)data[MQ131_LOG_RECORD_SIZE - 1] << 8);
+  if(crc != crc16(data, MQ131_LOG_RECORD_SIZE - 2)) {
+    return false;
+  }
+  uint32_t ppb = readUInt32(&data[8]);
+  uint32_t supply = readUInt32(&data[20]);
+  record.sequence = readUInt32(&data[0]);
+  record.timestamp = readUInt32(&data[4]);
+  memcpy(&record.ppb, &ppb, sizeof(ppb));
+  record.adc = data[12] | ((uint16_t)data[13] << 8);
+  record.loadResistor = data[14];
+  record.rl = readUInt32(&data[16]);
+  memcpy(&record.supply, &supply, sizeof(supply));
+  return true;
+}
+
+/**
+ * Check if a slot is erased (never written)
+ */
+bool MQ131LogClass::isErased(const uint8_t* data) {
+  for(uint8_t i = 0; i < MQ131_LOG_RECORD_SIZE; i++) {
+    if(data[i] != 0xFF) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,134 @@
+/******************************************************************************
+ * Arduino-MQ131-driver                                                       *
+ * --------------------                                                       *
+ * Arduino driver for gas sensor MQ131 (O3)                                   *
+ * Author: Olivier Staquet                                                    *
+ * Last version available on https://github.com/ostaquet/Arduino-MQ131-driver *
+ ******************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2018 Olivier Staquet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *******************************************************************************/
+
+#ifndef _MQ131_LOG_H_
+#define _MQ131_LOG_H_
+
+#include <Arduino.h>
+#include "MQ131.h"
+#include "MQ131Compressor.h"
+
+// Size of a record on the storage (bytes)
+// sequence (4), timestamp (4), concentration in ppb (float, 4), ADC code (2),
+// index of the load resistor (1), reserved (1), load resistance in Ohms (4),
+// supply in ADC steps (float, 4), reserved (6), CRC16 (2)
+// All fields are stored in little endian, the reserved bytes are 0
+#define MQ131_LOG_RECORD_SIZE                       32
+
+// Reading stored in the log
+struct MQ131Record {
+	uint32_t sequence;         // Position of the record since the creation of the log
+	uint32_t timestamp;        // Timestamp given by the application (e.g. seconds)
+	float ppb;                 // Concentration of O3 (ppb)
+	uint16_t adc;              // Raw ADC code of the reading
+	uint8_t loadResistor;      // Index of the switchable load resistor (0 without them)
+	uint32_t rl;               // Load resistance of the reading (Ohms)
+	float supply;              // Supply of the sensor circuit (ADC steps)
+};
+
+// Interface to the storage of the log (implement it on top of your SPI
+// flash or SD library). Erased bytes must read 0xFF
+class MQ131LogStorage {
+	public:
+		virtual ~MQ131LogStorage() {}
+
+		// Geometry of the storage (bytes): total size, program page, erase block
+		// The size must be a multiple of the erase block, the erase block a
+		// multiple of the page and the page a multiple of MQ131_LOG_RECORD_SIZE
+		virtual uint32_t getSize() = 0;
+		virtual uint16_t getPageSize() = 0;
+		virtual uint32_t getEraseSize() = 0;
+
+		// Read, program (inside one page) and erase (one block)
+		virtual bool read(uint32_t address, uint8_t* data, uint16_t length) = 0;
+		virtual bool write(uint32_t address, const uint8_t* data, uint16_t length) = 0;
+		virtual bool erase(uint32_t address) = 0;
+};
+
+class MQ131LogClass {
+	public:
+		// Constructor
+		MQ131LogClass();
+		virtual ~MQ131LogClass();
+
+		// Open the log on the storage with a buffer of one page
+		// The end of the log is recovered after a power loss (records
+		// with a bad CRC are skipped)
+		bool begin(MQ131LogStorage* _storage, uint8_t* _buffer);
+
+		// Append a record (buffered until the page is full or flush())
+		// The ADC code is converted to Rs with the load resistance and the
+		// supply of the reading, so they are stored with it
+		bool append(uint32_t timestamp, float ppb, uint16_t adc, uint32_t rl,
+		            float supply = MQ131_ADC_STEPS, uint8_t loadResistor = 0);
+		bool append(MQ131Class& sensor, uint32_t timestamp);
+
+		// Write the buffered records to the storage
+		bool flush();
+
+		// Range of sequences available: [getFirstSequence(), getNextSequence()[
+		uint32_t getFirstSequence();
+		uint32_t getNextSequence();
+
+		// Read a record (false if erased, overwritten or corrupted)
+		bool read(uint32_t sequence, MQ131Record& record);
+
+		// Export the records from a sequence to the end of the log, compressed
+		// (see MQ131CompressorClass), return the number of records exported
+		uint32_t exportCompressed(Stream& output, uint32_t fromSequence);
+
+		// CRC16-CCITT used by the records (and the frames)
+		static uint16_t crc16(const uint8_t* data, uint8_t length);
+
+	private:
+		// Serialization of the records
+		static void encode(const MQ131Record& record, uint8_t* data);
+		static bool decode(const uint8_t* data, MQ131Record& record);
+		static bool isErased(const uint8_t* data);
+
+		// Address of a sequence on the storage
+		uint32_t getAddress(uint32_t sequence);
+
+		// Find the end of the log after a restart
+		bool recover();
+
+		// Storage and page buffer
+		MQ131LogStorage* storage = NULL;
+		uint8_t* buffer = NULL;
+		uint32_t capacity = 0;
+		uint16_t recordsPerPage = 0;
+		uint32_t recordsPerBlock = 0;
+
+		// Next sequence to write and first sequence not yet on the storage
+		uint32_t nextSequence = 0;
+		uint32_t flushedSequence = 0;
+};
+
+#endif // _MQ131_LOG_H_